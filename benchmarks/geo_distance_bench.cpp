@@ -0,0 +1,117 @@
+/*
+ * Бенчмарк пакетного расчёта расстояний: ComputeDistances со скалярной реализацией и с AVX2
+ * против цикла по ComputeDistance. Пакет - соседние остановки маршрута по городу,
+ * как при расчёте длины маршрута по координатам. Для каждого способа выводится время на пару
+ * и максимальная и средняя абсолютная погрешность относительно формулы гаверсинусов в long double.
+ * Сборка и запуск из корня репозитория:
+ *   g++ -std=c++20 -O2 -I. benchmarks/geo_distance_bench.cpp geo.cpp -o geo_distance_bench
+ *   ./geo_distance_bench [остановок в маршруте, по умолчанию 64]
+ */
+
+#include "geo.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+volatile double sink = 0.0;
+
+struct Route {
+    std::vector<geo::Coordinates> from;
+    std::vector<geo::Coordinates> to;
+    std::vector<geo::PreparedCoordinates> prepared_from;
+    std::vector<geo::PreparedCoordinates> prepared_to;
+};
+
+// Маршрут из stops остановок: каждая следующая в пределах пары километров от предыдущей
+Route MakeRoute(int stops) {
+    std::mt19937_64 random(42);
+    std::uniform_real_distribution<double> step(-0.015, 0.015);
+    Route route;
+    geo::Coordinates place{55.75, 37.62};
+    for (int i = 1; i < stops; ++i) {
+        const geo::Coordinates next{place.lat + step(random), place.lng + step(random)};
+        route.from.push_back(place);
+        route.to.push_back(next);
+        route.prepared_from.push_back(geo::Prepare(place));
+        route.prepared_to.push_back(geo::Prepare(next));
+        place = next;
+    }
+    return route;
+}
+
+long double ReferenceDistance(geo::Coordinates from, geo::Coordinates to) {
+    const long double dr = 3.141592653589793238462643383279502884L / 180;
+    const long double from_lat = from.lat * dr;
+    const long double to_lat = to.lat * dr;
+    const long double s_lat = std::sin((to_lat - from_lat) / 2);
+    const long double s_lng = std::sin((to.lng * dr - from.lng * dr) / 2);
+    const long double h = s_lat * s_lat + std::cos(from_lat) * std::cos(to_lat) * s_lng * s_lng;
+    return 2.0L * geo::EarthRadius * std::asin(std::sqrt(std::min(h, 1.0L)));
+}
+
+// Вызывает compute для маршрута rounds раз, выводит лучшее из пяти повторов время на пару и погрешность
+template <typename Compute>
+void Measure(std::string_view name, const Route& route, int rounds, Compute compute) {
+    std::vector<double> distances(route.from.size());
+    double best_ns = 0.0;
+    for (int repeat = 0; repeat < 5; ++repeat) {
+        double checksum = 0.0;
+        const auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < rounds; ++round) {
+            compute(route, distances);
+            checksum += distances[round % distances.size()];
+        }
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        const double ns = elapsed.count() / (static_cast<double>(rounds) * distances.size());
+        if (repeat == 0 || ns < best_ns) {
+            best_ns = ns;
+        }
+        // Сумма не даёт компилятору выбросить вычисления
+        sink = checksum;
+    }
+
+    long double max_error = 0;
+    long double total_error = 0;
+    for (size_t i = 0; i < distances.size(); ++i) {
+        const long double error = std::fabs(distances[i] - ReferenceDistance(route.from[i], route.to[i]));
+        max_error = std::max(max_error, error);
+        total_error += error;
+    }
+    std::cout << name << ": " << best_ns << " ns/pair, max error " << static_cast<double>(max_error)
+              << " m, mean error " << static_cast<double>(total_error / distances.size()) << " m\n";
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    const int stops = argc > 1 ? std::stoi(argv[1]) : 64;
+    const Route route = MakeRoute(stops);
+    const int rounds = std::max(1, 20000000 / stops);
+    std::cout << "route: " << stops << " stops, " << route.from.size() << " pairs, " << rounds << " rounds\n";
+
+    Measure("ComputeDistance loop"sv, route, rounds, [](const Route& route, std::vector<double>& distances) {
+        for (size_t i = 0; i < distances.size(); ++i) {
+            distances[i] = geo::ComputeDistance(route.from[i], route.to[i]);
+        }
+    });
+    Measure("ComputeDistances, scalar"sv, route, rounds, [](const Route& route, std::vector<double>& distances) {
+        geo::ComputeDistances(route.prepared_from, route.prepared_to, distances, geo::DistanceKernel::Scalar);
+    });
+    if (geo::IsSupported(geo::DistanceKernel::Avx2)) {
+        Measure("ComputeDistances, AVX2"sv, route, rounds, [](const Route& route, std::vector<double>& distances) {
+            geo::ComputeDistances(route.prepared_from, route.prepared_to, distances, geo::DistanceKernel::Avx2);
+        });
+    } else {
+        std::cout << "ComputeDistances, AVX2: not supported by this processor\n";
+    }
+}
@@ -0,0 +1,137 @@
+/*
+ * Микробенчмарк разбора чисел JSON на документе с координатами и расстояниями,
+ * похожем на base_requests. Сравнивает прежний способ (цифры копируются в std::string,
+ * затем std::stoi с переходом на std::stod по исключению) с разбором std::from_chars
+ * прямо во входном буфере, который использует json::Reader.
+ * Сборка и запуск из корня репозитория:
+ *   g++ -std=c++20 -O2 -I. benchmarks/json_number_bench.cpp json.cpp text_scan.cpp -o json_number_bench
+ *   ./json_number_bench [число остановок, по умолчанию 200000]
+ */
+
+#include "json.h"
+
+#include <cctype>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+std::string MakeDocument(int stops) {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<double> latitude(55.5, 55.9);
+    std::uniform_real_distribution<double> longitude(37.3, 37.9);
+    std::uniform_int_distribution<int> distance(100, 5000);
+    std::uniform_int_distribution<int> neighbour(0, stops - 1);
+
+    std::string text = "[";
+    char number[32];
+    for (int i = 0; i < stops; ++i) {
+        if (i > 0) {
+            text += ',';
+        }
+        text += R"({"type": "Stop", "name": "S)" + std::to_string(i) + R"(", "latitude": )";
+        snprintf(number, sizeof(number), "%.6f", latitude(random));
+        text += number;
+        text += R"(, "longitude": )";
+        snprintf(number, sizeof(number), "%.6f", longitude(random));
+        text += number;
+        text += R"(, "road_distances": {)";
+        for (int j = 0; j < 3; ++j) {
+            text += (j > 0 ? R"(, "S)" : R"("S)") + std::to_string(neighbour(random)) + R"(": )"
+                + std::to_string(distance(random));
+        }
+        text += "}}";
+    }
+    text += "]";
+    return text;
+}
+
+// Находит в документе тексты всех чисел
+std::vector<std::string_view> FindNumbers(std::string_view text) {
+    std::vector<std::string_view> numbers;
+    bool in_string = false;
+    for (size_t i = 0; i < text.size(); ++i) {
+        const char c = text[i];
+        if (in_string) {
+            in_string = !(c == '"' && text[i - 1] != '\\');
+        } else if (c == '"') {
+            in_string = true;
+        } else if (c == '-' || std::isdigit(static_cast<unsigned char>(c))) {
+            const size_t begin = i;
+            while (i < text.size() && std::string_view("-+.eE0123456789").find(text[i]) != std::string_view::npos) {
+                ++i;
+            }
+            numbers.push_back(text.substr(begin, i - begin));
+            --i;
+        }
+    }
+    return numbers;
+}
+
+// Прежний разбор: посимвольное копирование в строку и std::stoi, при неудаче std::stod
+double ParseWithStrings(std::string_view token) {
+    std::string parsed_num;
+    bool is_int = true;
+    for (const char c : token) {
+        parsed_num += c;
+        is_int = is_int && c != '.' && c != 'e' && c != 'E';
+    }
+    if (is_int) {
+        try {
+            return std::stoi(parsed_num);
+        } catch (...) {
+        }
+    }
+    return std::stod(parsed_num);
+}
+
+// Текущий разбор через json::Reader: целые и дробные числа, как при декодировании запросов
+double ParseWithReader(std::string_view token) {
+    return json::Reader(token).ReadDouble();
+}
+
+template <typename Parse>
+double Measure(std::string_view name, const std::vector<std::string_view>& numbers, int rounds, Parse parse) {
+    double checksum = 0.0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        for (const auto token : numbers) {
+            checksum += parse(token);
+        }
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << name << ": " << elapsed.count() / (static_cast<double>(numbers.size()) * rounds)
+              << " ns/number\n";
+    return checksum;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    const int stops = argc > 1 ? std::stoi(argv[1]) : 200000;
+    const std::string text = MakeDocument(stops);
+    const auto numbers = FindNumbers(text);
+    std::cout << "document: " << text.size() / 1024 << " KB, " << numbers.size() << " numbers\n";
+
+    constexpr int kRounds = 5;
+    const double old_sum = Measure("string + stoi/stod"sv, numbers, kRounds, ParseWithStrings);
+    const double new_sum = Measure("from_chars in place"sv, numbers, kRounds, ParseWithReader);
+    if (old_sum != new_sum) {
+        std::cerr << "checksum mismatch: " << old_sum << " != " << new_sum << '\n';
+        return 1;
+    }
+
+    // Разбор всего документа для сравнения с долей чисел в нём
+    const auto start = std::chrono::steady_clock::now();
+    const json::Document document = json::Load(text);
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "json::Load of the document: " << elapsed.count() << " ms ("
+              << document.GetRoot().AsArray().size() << " stops)\n";
+}
@@ -0,0 +1,185 @@
+/*
+ * Бенчмарк разбора большого документа base_requests: время и пиковый объём динамической памяти
+ * на мегабайт входных данных. Сравнивает построение дерева json::Node через json::Load
+ * с чтением запросов напрямую в структуры JsonReader::ParseCommands (из буфера и из потока).
+ * Память считается заменённым глобальным operator new: учитываются живые блоки
+ * с размером по malloc_usable_size, входной текст в замер не входит.
+ * Сборка и запуск из корня репозитория:
+ *   g++ -std=c++20 -O2 -pthread -I. benchmarks/json_parse_bench.cpp $(ls *.cpp | grep -v main.cpp) -o json_parse_bench
+ *   ./json_parse_bench [число остановок, по умолчанию 200000]
+ */
+
+#include "json.h"
+#include "json_reader.h"
+
+#include <malloc.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <istream>
+#include <memory>
+#include <new>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+using namespace std::literals;
+
+namespace {
+
+size_t allocations = 0;
+size_t live_bytes = 0;
+size_t peak_bytes = 0;
+
+void* Allocate(size_t size) {
+    void* ptr = std::malloc(size ? size : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    ++allocations;
+    live_bytes += malloc_usable_size(ptr);
+    peak_bytes = std::max(peak_bytes, live_bytes);
+    return ptr;
+}
+
+void Free(void* ptr) {
+    if (ptr) {
+        live_bytes -= malloc_usable_size(ptr);
+        std::free(ptr);
+    }
+}
+
+}
+
+void* operator new(size_t size) {
+    return Allocate(size);
+}
+
+void* operator new[](size_t size) {
+    return Allocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    Free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    Free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    Free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    Free(ptr);
+}
+
+namespace {
+
+// Остановки с тремя расстояниями до соседей и маршруты по 20 остановок, как во входных данных справочника
+std::string MakeDocument(int stops) {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<double> latitude(55.5, 55.9);
+    std::uniform_real_distribution<double> longitude(37.3, 37.9);
+    std::uniform_int_distribution<int> distance(100, 5000);
+    std::uniform_int_distribution<int> neighbour(0, stops - 1);
+
+    std::string text = R"({"base_requests": [)";
+    char number[32];
+    for (int i = 0; i < stops; ++i) {
+        text += R"({"type": "Stop", "name": "Stop )" + std::to_string(i) + R"(", "latitude": )";
+        snprintf(number, sizeof(number), "%.6f", latitude(random));
+        text += number;
+        text += R"(, "longitude": )";
+        snprintf(number, sizeof(number), "%.6f", longitude(random));
+        text += number;
+        text += R"(, "road_distances": {)";
+        for (int j = 0; j < 3; ++j) {
+            text += (j > 0 ? R"(, "Stop )" : R"("Stop )") + std::to_string(neighbour(random)) + R"(": )"
+                + std::to_string(distance(random));
+        }
+        text += "}},";
+    }
+    const int buses = stops / 20;
+    for (int i = 0; i < buses; ++i) {
+        if (i > 0) {
+            text += ',';
+        }
+        text += R"({"type": "Bus", "name": "Bus )" + std::to_string(i) + R"(", "stops": [)";
+        for (int j = 0; j < 20; ++j) {
+            text += (j > 0 ? R"(, "Stop )" : R"("Stop )") + std::to_string(neighbour(random)) + '"';
+        }
+        text += R"(], "is_roundtrip": false})";
+    }
+    text += R"(], "stat_requests": []})";
+    return text;
+}
+
+// Поток чтения из готового текста без его копирования, чтобы копия не попала в замер памяти
+class TextBuffer : public std::streambuf {
+public:
+    explicit TextBuffer(std::string_view text) {
+        char* begin = const_cast<char*>(text.data());
+        setg(begin, begin, begin + text.size());
+    }
+};
+
+// Выполняет разбор несколько раз и выводит лучшее время и пиковую память одного разбора
+template <typename Parse>
+void Measure(std::string_view name, size_t input_size, Parse parse) {
+    constexpr int kRounds = 3;
+    const double input_mb = static_cast<double>(input_size) / (1 << 20);
+    double best_ms = 0.0;
+    size_t peak = 0;
+    size_t count = 0;
+    for (int round = 0; round < kRounds; ++round) {
+        const size_t base = live_bytes;
+        peak_bytes = live_bytes;
+        allocations = 0;
+        const auto start = std::chrono::steady_clock::now();
+        {
+            // Результат разбора живёт до конца замера, время включает его освобождение
+            const auto result = parse();
+            (void)result;
+        }
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        if (round == 0 || elapsed.count() < best_ms) {
+            best_ms = elapsed.count();
+        }
+        peak = peak_bytes - base;
+        count = allocations;
+    }
+    std::cout << name << ": " << best_ms / input_mb << " ms/MB, peak "
+              << static_cast<double>(peak) / (1 << 20) / input_mb << " MB/MB, "
+              << static_cast<double>(count) / input_mb << " allocations/MB\n";
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    const int stops = argc > 1 ? std::stoi(argv[1]) : 200000;
+    const std::string text = MakeDocument(stops);
+    std::cout << "document: " << text.size() / (1 << 20) << " MB, " << stops << " stops, " << stops / 20
+              << " buses\n";
+
+    Measure("json::Load (Node tree)"sv, text.size(), [&text] {
+        return json::Load(std::string_view(text));
+    });
+    Measure("JsonReader::ParseCommands, buffer"sv, text.size(), [&text] {
+        auto reader = std::make_unique<JsonReader>();
+        reader->ParseCommands(std::string_view(text));
+        return reader;
+    });
+    Measure("JsonReader::ParseCommands, stream"sv, text.size(), [&text] {
+        TextBuffer buffer(text);
+        std::istream input(&buffer);
+        auto reader = std::make_unique<JsonReader>();
+        reader->ParseCommands(input);
+        return reader;
+    });
+}
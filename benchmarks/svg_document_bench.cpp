@@ -0,0 +1,239 @@
+/*
+ * Бенчмарк построения и вывода большого SVG-документа: 1M элементов, поровну кружков, ломаных и надписей
+ * с общими стилями, как на карте маршрутов. Сравнивает svg::Document, который хранит копию каждого
+ * элемента в куче по unique_ptr, и svg::DocumentStream, который выводит элемент сразу.
+ * Элементы строятся заранее и в замер не входят. Для каждого этапа выводится время
+ * и число выделений памяти на элемент, для способа целиком - пиковый объём живой памяти.
+ * Вывод идёт в поток, который только считает байты и их хеш, оба способа должны дать одинаковый текст.
+ * Память считается заменённым глобальным operator new по malloc_usable_size.
+ * Сборка и запуск из корня репозитория:
+ *   g++ -std=c++20 -O2 -I. benchmarks/svg_document_bench.cpp svg.cpp text_scan.cpp -o svg_document_bench
+ *   ./svg_document_bench [число элементов, по умолчанию 1000000]
+ */
+
+#include "svg.h"
+
+#include <malloc.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+size_t allocations = 0;
+size_t live_bytes = 0;
+size_t peak_bytes = 0;
+
+void* Allocate(size_t size) {
+    void* ptr = std::malloc(size ? size : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    ++allocations;
+    live_bytes += malloc_usable_size(ptr);
+    peak_bytes = std::max(peak_bytes, live_bytes);
+    return ptr;
+}
+
+void Free(void* ptr) {
+    if (ptr) {
+        live_bytes -= malloc_usable_size(ptr);
+        std::free(ptr);
+    }
+}
+
+}
+
+void* operator new(size_t size) {
+    return Allocate(size);
+}
+
+void* operator new[](size_t size) {
+    return Allocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    Free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    Free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    Free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    Free(ptr);
+}
+
+namespace {
+
+// Поток, который отбрасывает вывод, запоминая его длину и хеш FNV-1a
+class HashBuffer : public std::streambuf {
+public:
+    uint64_t size = 0;
+    uint64_t hash = 14695981039346656037ull;
+
+protected:
+    std::streamsize xsputn(const char* data, std::streamsize count) override {
+        for (std::streamsize i = 0; i < count; ++i) {
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ull;
+        }
+        size += static_cast<uint64_t>(count);
+        return count;
+    }
+
+    int_type overflow(int_type c) override {
+        if (c != traits_type::eof()) {
+            const char ch = traits_type::to_char_type(c);
+            xsputn(&ch, 1);
+        }
+        return c;
+    }
+};
+
+// Элементы в порядке вывода: ломаная, надпись, кружок и так далее
+struct Elements {
+    std::vector<svg::Circle> circles;
+    std::vector<svg::Polyline> polylines;
+    std::vector<svg::Text> texts;
+};
+
+Elements MakeElements(size_t count) {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<double> coordinate(0.0, 1000.0);
+    const auto line_style = std::make_shared<svg::Style>(svg::Style{
+        std::nullopt, "green"s, 14.0, svg::StrokeLineCap::ROUND, svg::StrokeLineJoin::ROUND});
+    const auto label_style = std::make_shared<svg::Style>(svg::Style{"black"s, std::nullopt, std::nullopt,
+                                                                     std::nullopt, std::nullopt});
+    const auto stop_style = std::make_shared<svg::Style>(svg::Style{"white"s, std::nullopt, std::nullopt,
+                                                                    std::nullopt, std::nullopt});
+    Elements elements;
+    const size_t per_kind = count / 3;
+    for (size_t i = 0; i < per_kind; ++i) {
+        svg::Polyline line;
+        for (int j = 0; j < 8; ++j) {
+            line.AddPoint({coordinate(random), coordinate(random)});
+        }
+        elements.polylines.push_back(std::move(line.SetStyle(line_style)));
+        elements.texts.push_back(std::move(svg::Text()
+                                               .SetPosition({coordinate(random), coordinate(random)})
+                                               .SetOffset({7.0, -3.0})
+                                               .SetFontSize(20)
+                                               .SetFontFamily("Verdana"s)
+                                               .SetData("Stop "s + std::to_string(i))
+                                               .SetStyle(label_style)));
+        elements.circles.push_back(std::move(svg::Circle()
+                                                 .SetCenter({coordinate(random), coordinate(random)})
+                                                 .SetRadius(5.0)
+                                                 .SetStyle(stop_style)));
+    }
+    return elements;
+}
+
+class Stage {
+public:
+    Stage(std::string_view name, size_t elements)
+        : name_(name)
+        , elements_(elements)
+        , allocations_(allocations)
+        , start_(std::chrono::steady_clock::now()) {
+    }
+
+    ~Stage() {
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start_;
+        std::cout << "  " << name_ << ": " << elapsed.count() << " ms, "
+                  << elapsed.count() * 1e6 / static_cast<double>(elements_) << " ns/element, "
+                  << static_cast<double>(allocations - allocations_) / static_cast<double>(elements_)
+                  << " allocations/element\n";
+    }
+
+private:
+    std::string_view name_;
+    size_t elements_;
+    size_t allocations_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+void PrintPeak(size_t base, size_t elements) {
+    std::cout << "  peak: " << static_cast<double>(peak_bytes - base) / (1 << 20) << " MB, "
+              << static_cast<double>(peak_bytes - base) / static_cast<double>(elements) << " bytes/element\n";
+}
+
+HashBuffer RenderDocument(const Elements& elements, size_t count) {
+    std::cout << "svg::Document\n";
+    HashBuffer output;
+    std::ostream out(&output);
+    const size_t base = live_bytes;
+    peak_bytes = live_bytes;
+    auto doc = std::make_unique<svg::Document>();
+    {
+        Stage stage("build"sv, count);
+        for (size_t i = 0; i < elements.circles.size(); ++i) {
+            doc->Add(elements.polylines[i]);
+            doc->Add(elements.texts[i]);
+            doc->Add(elements.circles[i]);
+        }
+    }
+    {
+        Stage stage("render"sv, count);
+        doc->Render(out);
+    }
+    {
+        Stage stage("destroy"sv, count);
+        doc.reset();
+    }
+    PrintPeak(base, count);
+    return output;
+}
+
+HashBuffer RenderStream(const Elements& elements, size_t count) {
+    std::cout << "svg::DocumentStream\n";
+    HashBuffer output;
+    std::ostream out(&output);
+    const size_t base = live_bytes;
+    peak_bytes = live_bytes;
+    {
+        Stage stage("render"sv, count);
+        svg::DocumentStream doc(out);
+        for (size_t i = 0; i < elements.circles.size(); ++i) {
+            doc.Render(elements.polylines[i]);
+            doc.Render(elements.texts[i]);
+            doc.Render(elements.circles[i]);
+        }
+        doc.Close();
+    }
+    PrintPeak(base, count);
+    return output;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    const size_t count = argc > 1 ? std::stoul(argv[1]) / 3 * 3 : 1000000 / 3 * 3;
+    const Elements elements = MakeElements(count);
+    std::cout << count << " elements: " << count / 3 << " polylines, texts and circles\n";
+
+    const HashBuffer document = RenderDocument(elements, count);
+    const HashBuffer stream = RenderStream(elements, count);
+    std::cout << "output: " << document.size / (1 << 20) << " MB\n";
+    if (document.size != stream.size || document.hash != stream.hash) {
+        std::cerr << "outputs differ\n";
+        return 1;
+    }
+}
@@ -0,0 +1,244 @@
+#include "catalogue_snapshot.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+using namespace transport;
+using namespace transport::snapshot;
+
+namespace {
+
+constexpr uint64_t kAlignment = 8;
+
+uint64_t Align(uint64_t offset) {
+    return (offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+// Раскладывает массивы записей по файлу друг за другом с выравниванием
+class LayoutBuilder {
+public:
+    explicit LayoutBuilder(uint64_t start)
+        : end_(start) {
+    }
+
+    template <typename Record>
+    Section Place(const std::vector<Record>& records) {
+        Section section {Align(end_), records.size()};
+        end_ = section.offset + records.size() * sizeof(Record);
+        return section;
+    }
+
+    uint64_t GetEnd() const {
+        return end_;
+    }
+
+private:
+    uint64_t end_;
+};
+
+void WritePadding(std::ostream& out, uint64_t& written, uint64_t offset) {
+    static constexpr char zeros[kAlignment] = {};
+    out.write(zeros, static_cast<std::streamsize>(offset - written));
+    written = offset;
+}
+
+template <typename Record>
+void WriteSection(std::ostream& out, uint64_t& written, const Section& section, const std::vector<Record>& records) {
+    WritePadding(out, written, section.offset);
+    out.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(Record)));
+    written += records.size() * sizeof(Record);
+}
+
+}
+
+void transport::SaveSnapshot(const FrozenCatalogue& catalogue, std::ostream& out) {
+    // Номера неизменяемого справочника уже упорядочены по названиям и совпадают с номерами записей
+    std::vector<char> names;
+    auto add_name = [&names](std::string_view name) {
+        const NameRef ref {static_cast<uint32_t>(names.size()), static_cast<uint32_t>(name.size())};
+        names.insert(names.end(), name.begin(), name.end());
+        return ref;
+    };
+
+    std::vector<StopRecord> stops;
+    std::vector<uint32_t> stop_buses;
+    stops.reserve(catalogue.GetStopCount());
+    for (StopId stop = 0; stop < catalogue.GetStopCount(); ++stop) {
+        StopRecord record {};
+        record.name = add_name(catalogue.GetStopName(stop));
+        const auto place = catalogue.GetStopPlace(stop);
+        record.lat = place.lat;
+        record.lng = place.lng;
+        record.buses_begin = static_cast<uint32_t>(stop_buses.size());
+        for (const auto bus : catalogue.GetStopBuses(stop)) {
+            stop_buses.push_back(*catalogue.GetBus(bus));
+        }
+        record.buses_count = static_cast<uint32_t>(stop_buses.size() - record.buses_begin);
+        stops.push_back(record);
+    }
+
+    std::vector<BusRecord> buses;
+    std::vector<uint32_t> routes;
+    buses.reserve(catalogue.GetBusCount());
+    for (BusId bus = 0; bus < catalogue.GetBusCount(); ++bus) {
+        BusRecord record {};
+        record.name = add_name(catalogue.GetBusName(bus));
+        record.route_begin = static_cast<uint32_t>(routes.size());
+        const auto route = catalogue.GetRoute(bus);
+        routes.insert(routes.end(), route.begin(), route.end());
+        record.route_size = static_cast<uint32_t>(route.size());
+        try {
+            const auto stat = catalogue.GetStat(bus);
+            record.has_stat = 1;
+            record.route_length = stat->dist;
+            record.stops_count = stat->stops_count;
+            record.unique_stops = stat->unique_stops;
+            record.curvature = stat->curvature;
+        } catch (const std::out_of_range&) {
+            record.has_stat = 0;
+        }
+        buses.push_back(record);
+    }
+
+    Header header {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byte_order = kByteOrderMark;
+    LayoutBuilder layout(sizeof(Header));
+    header.names = layout.Place(names);
+    header.stops = layout.Place(stops);
+    header.buses = layout.Place(buses);
+    header.stop_buses = layout.Place(stop_buses);
+    header.routes = layout.Place(routes);
+    header.file_size = layout.GetEnd();
+
+    uint64_t written = sizeof(Header);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    WriteSection(out, written, header.names, names);
+    WriteSection(out, written, header.stops, stops);
+    WriteSection(out, written, header.buses, buses);
+    WriteSection(out, written, header.stop_buses, stop_buses);
+    WriteSection(out, written, header.routes, routes);
+    if (!out) {
+        throw std::runtime_error("failed to write catalogue snapshot");
+    }
+}
+
+CatalogueSnapshot::CatalogueSnapshot(const std::string& path)
+    : file_(path) {
+    const auto data = file_.GetData();
+    if (data.size() < sizeof(Header)) {
+        throw std::runtime_error("catalogue snapshot is truncated: " + path);
+    }
+    const auto* header = reinterpret_cast<const Header*>(data.data());
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("not a catalogue snapshot: " + path);
+    }
+    if (header->version != kVersion || header->byte_order != kByteOrderMark) {
+        throw std::runtime_error("unsupported catalogue snapshot version: " + path);
+    }
+    if (header->file_size != data.size()) {
+        throw std::runtime_error("catalogue snapshot is truncated: " + path);
+    }
+
+    names_ = GetSection<char>(header->names);
+    stops_ = GetSection<StopRecord>(header->stops);
+    stop_count_ = header->stops.count;
+    buses_ = GetSection<BusRecord>(header->buses);
+    bus_count_ = header->buses.count;
+    stop_buses_ = GetSection<uint32_t>(header->stop_buses);
+    const auto* routes = GetSection<uint32_t>(header->routes);
+
+    // Ссылки между записями проверяются один раз, чтобы запросы могли им доверять
+    auto check = [](bool ok) {
+        if (!ok) {
+            throw std::runtime_error("catalogue snapshot is corrupted");
+        }
+    };
+    auto check_name = [&](NameRef name) {
+        check(name.offset <= header->names.count && name.size <= header->names.count - name.offset);
+    };
+    for (size_t i = 0; i < stop_count_; ++i) {
+        const auto& stop = stops_[i];
+        check_name(stop.name);
+        check(stop.buses_begin <= header->stop_buses.count && stop.buses_count <= header->stop_buses.count - stop.buses_begin);
+    }
+    for (size_t i = 0; i < bus_count_; ++i) {
+        const auto& bus = buses_[i];
+        check_name(bus.name);
+        check(bus.route_begin <= header->routes.count && bus.route_size <= header->routes.count - bus.route_begin);
+    }
+    for (size_t i = 0; i < header->stop_buses.count; ++i) {
+        check(stop_buses_[i] < bus_count_);
+    }
+    for (size_t i = 0; i < header->routes.count; ++i) {
+        check(routes[i] < stop_count_);
+    }
+}
+
+template <typename Record>
+const Record* CatalogueSnapshot::GetSection(const Section& section) const {
+    const auto data = file_.GetData();
+    if (section.offset % alignof(Record) != 0 || section.offset > data.size()
+        || section.count > (data.size() - section.offset) / sizeof(Record)) {
+        throw std::runtime_error("catalogue snapshot is corrupted");
+    }
+    return reinterpret_cast<const Record*>(data.data() + section.offset);
+}
+
+std::string_view CatalogueSnapshot::GetStopName(StopId stop) const {
+    return GetName(stops_[stop].name);
+}
+
+const StopIndex& CatalogueSnapshot::GetStopIndex() const {
+    std::call_once(stop_index_built_, [this] {
+        std::vector<geo::Coordinates> places;
+        places.reserve(stop_count_);
+        for (size_t i = 0; i < stop_count_; ++i) {
+            places.push_back({stops_[i].lat, stops_[i].lng});
+        }
+        stop_index_ = StopIndex(places);
+    });
+    return stop_index_;
+}
+
+std::string_view CatalogueSnapshot::GetName(NameRef name) const {
+    return {names_ + name.offset, name.size};
+}
+
+template <typename Record>
+const Record* CatalogueSnapshot::FindByName(const Record* records, size_t count, std::string_view id) const {
+    const Record* end = records + count;
+    const Record* it = std::lower_bound(records, end, id, [this](const Record& record, std::string_view id) {
+        return GetName(record.name) < id;
+    });
+    if (it == end || GetName(it->name) != id) {
+        return nullptr;
+    }
+    return it;
+}
+
+const BusRecord* CatalogueSnapshot::GetBus(const std::string_view id) const {
+    return FindByName(buses_, bus_count_, id);
+}
+
+const std::optional<RouteStatistics> CatalogueSnapshot::GetStat(const BusRecord* bus) const {
+    if (!bus) {
+        return std::nullopt;
+    }
+    if (!bus->has_stat) {
+        throw std::out_of_range("distances for bus " + std::string(GetName(bus->name)) + " not found in base");
+    }
+    return RouteStatistics {bus->route_length, bus->stops_count, bus->unique_stops, bus->curvature};
+}
+
+std::optional<CatalogueSnapshot::BusNames> CatalogueSnapshot::GetBusses4Stop(const std::string_view id) const {
+    const auto* stop = FindByName(stops_, stop_count_, id);
+    if (!stop) {
+        return std::nullopt;
+    }
+    const uint32_t* begin = stop_buses_ + stop->buses_begin;
+    return BusNames(this, begin, begin + stop->buses_count);
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "transport_catalogue.h"
+
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+/*
+ * Двоичный снимок построенного транспортного справочника.
+ * Снимок отображается в память и читается на месте: записи ссылаются друг на друга
+ * индексами и смещениями, названия хранятся в общей таблице строк.
+ * Остановки и маршруты упорядочены по названию, поиск выполняется двоичным поиском,
+ * статистика маршрутов вычисляется при записи снимка
+ */
+
+namespace transport {
+
+namespace snapshot {
+
+inline constexpr char kMagic[8] = {'T', 'C', 'S', 'N', 'A', 'P', '\0', '\0'};
+inline constexpr uint32_t kVersion = 1;
+// Снимок переносим только между машинами с одинаковым порядком байт
+inline constexpr uint32_t kByteOrderMark = 0x01020304;
+
+// Расположение массива записей внутри файла
+struct Section {
+    uint64_t offset = 0;
+    uint64_t count = 0;
+};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t file_size;
+    Section names;
+    Section stops;
+    Section buses;
+    Section stop_buses;
+    Section routes;
+};
+
+struct NameRef {
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct StopRecord {
+    NameRef name;
+    // Маршруты через остановку: диапазон в stop_buses, индексы записей BusRecord
+    uint32_t buses_begin;
+    uint32_t buses_count;
+    double lat;
+    double lng;
+};
+
+struct BusRecord {
+    NameRef name;
+    // Остановки маршрута: диапазон в routes, индексы записей StopRecord
+    uint32_t route_begin;
+    uint32_t route_size;
+    int32_t route_length;
+    // 0, если для маршрута не хватило расстояний между остановками
+    uint32_t has_stat;
+    uint64_t stops_count;
+    uint64_t unique_stops;
+    double curvature;
+};
+
+}  // namespace snapshot
+
+void SaveSnapshot(const FrozenCatalogue& catalogue, std::ostream& out);
+
+class CatalogueSnapshot {
+public:
+    // Последовательность названий маршрутов, проходящих через остановку
+    class BusNames {
+    public:
+        class Iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::string_view;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const std::string_view*;
+            using reference = std::string_view;
+
+            Iterator() = default;
+            Iterator(const CatalogueSnapshot* snapshot, const uint32_t* index)
+                : snapshot_(snapshot)
+                , index_(index) {
+            }
+
+            std::string_view operator*() const {
+                return snapshot_->GetName(snapshot_->buses_[*index_].name);
+            }
+            Iterator& operator++() {
+                ++index_;
+                return *this;
+            }
+            Iterator operator++(int) {
+                Iterator prev = *this;
+                ++index_;
+                return prev;
+            }
+            bool operator==(const Iterator& other) const {
+                return index_ == other.index_;
+            }
+            bool operator!=(const Iterator& other) const {
+                return index_ != other.index_;
+            }
+
+        private:
+            const CatalogueSnapshot* snapshot_ = nullptr;
+            const uint32_t* index_ = nullptr;
+        };
+
+        BusNames(const CatalogueSnapshot* snapshot, const uint32_t* begin, const uint32_t* end)
+            : snapshot_(snapshot)
+            , begin_(begin)
+            , end_(end) {
+        }
+
+        Iterator begin() const {
+            return {snapshot_, begin_};
+        }
+        Iterator end() const {
+            return {snapshot_, end_};
+        }
+        size_t size() const {
+            return end_ - begin_;
+        }
+
+    private:
+        const CatalogueSnapshot* snapshot_;
+        const uint32_t* begin_;
+        const uint32_t* end_;
+    };
+
+    explicit CatalogueSnapshot(const std::string& path);
+
+    const snapshot::BusRecord* GetBus(const std::string_view id) const;
+    const std::optional<RouteStatistics> GetStat(const snapshot::BusRecord* bus) const;
+    std::optional<BusNames> GetBusses4Stop(const std::string_view id) const;
+
+    // Номер остановки - позиция её записи, записи упорядочены по названию
+    std::string_view GetStopName(StopId stop) const;
+    // Индекс строится при первом пространственном запросе, чтобы не замедлять открытие снимка
+    const StopIndex& GetStopIndex() const;
+
+private:
+    std::string_view GetName(snapshot::NameRef name) const;
+
+    template <typename Record>
+    const Record* FindByName(const Record* records, size_t count, std::string_view id) const;
+
+    template <typename Record>
+    const Record* GetSection(const snapshot::Section& section) const;
+
+    MappedFile file_;
+    const char* names_ = nullptr;
+    const snapshot::StopRecord* stops_ = nullptr;
+    size_t stop_count_ = 0;
+    const snapshot::BusRecord* buses_ = nullptr;
+    size_t bus_count_ = 0;
+    const uint32_t* stop_buses_ = nullptr;
+
+    mutable std::once_flag stop_index_built_;
+    mutable StopIndex stop_index_;
+};
+
+}  // namespace transport
@@ -12,8 +12,3 @@
  * Если структура вашего приложения не позволяет так сделать, просто оставьте этот файл пустым.
  *
  */
-
-std::string_view Commands::AddId(const std::string& id) {
-    ids_.push_front(id);
-    return {ids_.front().begin(), ids_.front().end()};
-}
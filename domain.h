@@ -2,10 +2,12 @@
 
 #include "geo.h"
 
+#include <optional>
 #include <string>
+#include <string_view>
+#include <tuple>
 #include <vector>
 #include <unordered_map>
-#include <forward_list>
 
 /*
  * В этом файле вы можете разместить классы/структуры, которые являются частью предметной области (domain)
@@ -19,9 +21,75 @@
  *
  */
 
+// Обязательное поле должно присутствовать во внешнем формате, необязательное сохраняет значение по умолчанию
+enum class Presence {
+    Required,
+    Optional
+};
+
+/*
+ * Описание поля структуры для чтения из внешнего формата (например, JSON):
+ * ключ, указатель на член структуры и обязательность. Структуры перечисляют свои поля один раз
+ * в статическом кортеже kFields
+ */
+template <typename Owner, typename Member>
+struct Field {
+    using Type = Member;
+
+    constexpr Field(std::string_view key, Member Owner::* member, Presence presence = Presence::Required)
+        : key(key)
+        , member(member)
+        , presence(presence) {
+    }
+
+    Member& Get(Owner& owner) const {
+        return owner.*member;
+    }
+
+    constexpr bool IsRequired() const {
+        return presence == Presence::Required;
+    }
+
+    std::string_view key;
+    Member Owner::* member;
+    Presence presence;
+};
+
+// Поле вложенной структуры, которое во внешнем формате лежит на одном уровне с полями владельца
+template <typename Owner, typename Inner, typename Member>
+struct SubField {
+    using Type = Member;
+
+    constexpr SubField(std::string_view key, Inner Owner::* inner, Member Inner::* member,
+                       Presence presence = Presence::Required)
+        : key(key)
+        , inner(inner)
+        , member(member)
+        , presence(presence) {
+    }
+
+    Member& Get(Owner& owner) const {
+        return owner.*inner.*member;
+    }
+
+    constexpr bool IsRequired() const {
+        return presence == Presence::Required;
+    }
+
+    std::string_view key;
+    Inner Owner::* inner;
+    Member Inner::* member;
+    Presence presence;
+};
+
 enum class StatType {
     Bus,
-    Stop
+    Stop,
+    Route,
+    NearestStops,
+    StopsInRadius,
+    StopsInBox,
+    Map
 };
 
 struct Dist2Stop {
@@ -38,25 +106,116 @@ struct StopRequest {
     std::string name;
     geo::Coordinates place;
     std::vector<StopDistance> road_distances;
+
+    static constexpr std::string_view kType = "Stop";
+    static constexpr std::tuple kFields {
+        Field {"name", &StopRequest::name},
+        SubField {"latitude", &StopRequest::place, &geo::Coordinates::lat},
+        SubField {"longitude", &StopRequest::place, &geo::Coordinates::lng},
+        Field {"road_distances", &StopRequest::road_distances, Presence::Optional},
+    };
 };
 
+// Остановки некольцевого маршрута перечислены только в прямом направлении
 struct BusRequest {
     std::string name;
-    std::vector<std::string_view> stops;
-    bool is_roundtrip;
+    std::vector<std::string> stops;
+    bool is_roundtrip = false;
+
+    static constexpr std::string_view kType = "Bus";
+    static constexpr std::tuple kFields {
+        Field {"name", &BusRequest::name},
+        Field {"stops", &BusRequest::stops},
+        Field {"is_roundtrip", &BusRequest::is_roundtrip},
+    };
 };
 
+/*
+ * Плитка карты: на уровне zoom холст делится на 2^zoom x 2^zoom равных частей,
+ * x - номер столбца слева, y - номер строки сверху
+ */
+struct MapTile {
+    int zoom = 0;
+    int x = 0;
+    int y = 0;
+
+    bool operator==(const MapTile&) const = default;
+
+    static constexpr std::tuple kFields {
+        Field {"zoom", &MapTile::zoom},
+        Field {"x", &MapTile::x},
+        Field {"y", &MapTile::y},
+    };
+};
+
+// Часть карты в прямоугольнике широт и долгот от min_place до max_place
+struct MapBox {
+    geo::Coordinates min_place {};
+    geo::Coordinates max_place {};
+
+    static constexpr std::tuple kFields {
+        SubField {"min_latitude", &MapBox::min_place, &geo::Coordinates::lat},
+        SubField {"min_longitude", &MapBox::min_place, &geo::Coordinates::lng},
+        SubField {"max_latitude", &MapBox::max_place, &geo::Coordinates::lat},
+        SubField {"max_longitude", &MapBox::max_place, &geo::Coordinates::lng},
+    };
+};
+
+/*
+ * Запрос Route использует from и to вместо name.
+ * NearestStops ищет count ближайших к place остановок, StopsInRadius - остановки не дальше radius метров
+ * от place, StopsInBox - остановки в прямоугольнике широт и долгот от min_place до max_place.
+ * Map рисует всю карту, а с заданными tile или bbox - только её часть
+ */
 struct StatRequest {
-    int id;
-    StatType type;
+    int id = 0;
+    StatType type = StatType::Bus;
     std::string name;
+    std::string from;
+    std::string to;
+    geo::Coordinates place {};
+    int count = 0;
+    double radius = 0.0;
+    geo::Coordinates min_place {};
+    geo::Coordinates max_place {};
+    std::optional<MapTile> tile;
+    std::optional<MapBox> bbox;
+
+    static constexpr std::tuple kFields {
+        Field {"id", &StatRequest::id},
+        Field {"type", &StatRequest::type},
+        Field {"name", &StatRequest::name, Presence::Optional},
+        Field {"from", &StatRequest::from, Presence::Optional},
+        Field {"to", &StatRequest::to, Presence::Optional},
+        SubField {"latitude", &StatRequest::place, &geo::Coordinates::lat, Presence::Optional},
+        SubField {"longitude", &StatRequest::place, &geo::Coordinates::lng, Presence::Optional},
+        Field {"count", &StatRequest::count, Presence::Optional},
+        Field {"radius", &StatRequest::radius, Presence::Optional},
+        SubField {"min_latitude", &StatRequest::min_place, &geo::Coordinates::lat, Presence::Optional},
+        SubField {"min_longitude", &StatRequest::min_place, &geo::Coordinates::lng, Presence::Optional},
+        SubField {"max_latitude", &StatRequest::max_place, &geo::Coordinates::lat, Presence::Optional},
+        SubField {"max_longitude", &StatRequest::max_place, &geo::Coordinates::lng, Presence::Optional},
+        Field {"tile", &StatRequest::tile, Presence::Optional},
+        Field {"bbox", &StatRequest::bbox, Presence::Optional},
+    };
+};
+
+// Время ожидания автобуса на остановке в минутах и скорость автобуса в км/ч
+struct RoutingSettings {
+    int bus_wait_time = 0;
+    double bus_velocity = 0.0;
+
+    bool operator==(const RoutingSettings&) const = default;
+
+    static constexpr std::tuple kFields {
+        Field {"bus_wait_time", &RoutingSettings::bus_wait_time},
+        Field {"bus_velocity", &RoutingSettings::bus_velocity},
+    };
 };
 
 struct Commands {
     std::vector<StopRequest> stop_requests;
     std::vector<BusRequest> bus_requests;
     std::vector<StatRequest> stat_requests;
-    std::string_view AddId(const std::string& id);
-private:
-    std::forward_list<std::string> ids_;
+    std::optional<RoutingSettings> routing_settings;
 };
@@ -1,7 +1,14 @@
 #define _USE_MATH_DEFINES
 #include "geo.h"
 
+#include <algorithm>
 #include <cmath>
+#include <stdexcept>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define GEO_X86
+#endif
 
 namespace geo {
 
@@ -13,4 +20,258 @@ double ComputeDistance(Coordinates from, Coordinates to) {
         * 6371000;
 }
 
+PreparedCoordinates Prepare(Coordinates place) {
+    const double dr = M_PI / 180.0;
+    return {place.lat * dr, place.lng * dr, std::cos(place.lat * dr)};
+}
+
+namespace {
+
+/*
+ * Расстояние считается по формуле гаверсинусов:
+ *   h = sin²(Δφ/2) + cos φ1 · cos φ2 · sin²(Δλ/2),  d = 2R · asin(√h).
+ * В отличие от acos в ComputeDistance она не теряет точность на близких точках.
+ *
+ * sin(x) на [0, π/2] - ряд Тейлора до x^19, остаток меньше (π/2)^21 / 21! < 2.6e-16.
+ * Аргумент приводится к [0, π/2] через sin(x) = sin(π - x).
+ * asin(z) на [0, 1/2] - ряд Тейлора до z^45, остаток меньше 2.4e-17.
+ * При y > 1/2 используется asin(y) = π/2 - 2·asin(√((1 - y)/2)).
+ * С учётом округлений погрешность расстояния между заданными в радианах точками не больше
+ * 5e-15 · d плюс вклад округления h: ошибка h до 16ε даёт 16ε · R · tg(θ/2), θ = d / R.
+ * У почти противоположных точек asin(√h) плохо обусловлен, и этот вклад растёт до 4R · √ε, около 0.4 м.
+ * Широта и долгота округляются при переводе в радианы, поэтому у близких точек дополнительно
+ * возникает погрешность порядка 1e-16 · φ / Δφ: около 4e-11 для точек в 100 м друг от друга.
+ *
+ * Векторная и скалярная версии выполняют одни и те же операции в одном порядке,
+ * умножение со сложением - через fma с одним округлением, поэтому результаты совпадают побитово.
+ * На процессоре без fma программный std::fma в несколько раз медленнее acos в ComputeDistance,
+ * поэтому там скалярная версия умножает и складывает отдельно. Векторной версии на таком процессоре нет,
+ * совпадать не с чем, а погрешность остаётся в тех же пределах
+ */
+
+constexpr double kHalfPi = M_PI / 2.0;
+
+constexpr double kSinCoefficients[] = {
+    1.0, -0.16666666666666666, 0.008333333333333333, -0.0001984126984126984,
+    2.7557319223985893e-06, -2.505210838544172e-08, 1.6059043836821613e-10, -7.647163731819816e-13,
+    2.8114572543455206e-15, -8.22063524662433e-18,
+};
+
+constexpr double kAsinCoefficients[] = {
+    1.0, 0.16666666666666666, 0.075, 0.044642857142857144,
+    0.030381944444444444, 0.022372159090909092, 0.017352764423076924, 0.01396484375,
+    0.011551800896139705, 0.009761609529194078, 0.008390335809616815, 0.0073125258735988454,
+    0.006447210311889649, 0.005740037670841924, 0.005153309682319905, 0.004660143486915096,
+    0.004240907093679363, 0.003880964558837669, 0.0035692053938259347, 0.003297059503473485,
+    0.0030578216492580306, 0.002846178401108942, 0.00265787063820729,
+};
+
+constexpr int kSinTerms = sizeof(kSinCoefficients) / sizeof(double);
+constexpr int kAsinTerms = sizeof(kAsinCoefficients) / sizeof(double);
+
+template <bool kFma>
+[[gnu::always_inline]] inline double MulAdd(double a, double b, double c) {
+    if constexpr (kFma) {
+        return std::fma(a, b, c);
+    } else {
+        return a * b + c;
+    }
+}
+
+// sin(|x|) при |x| <= π
+template <bool kFma>
+[[gnu::always_inline]] inline double Sin(double x) {
+    double t = std::fabs(x);
+    const double reflected = M_PI - t;
+    t = t < reflected ? t : reflected;
+    const double u = t * t;
+    double p = kSinCoefficients[kSinTerms - 1];
+    for (int i = kSinTerms - 2; i >= 0; --i) {
+        p = MulAdd<kFma>(p, u, kSinCoefficients[i]);
+    }
+    return t * p;
+}
+
+// asin(y) при y из [0, 1]
+template <bool kFma>
+[[gnu::always_inline]] inline double Asin(double y) {
+    const bool reduced = y > 0.5;
+    const double z = reduced ? std::sqrt((1.0 - y) * 0.5) : y;
+    const double u = z * z;
+    double p = kAsinCoefficients[kAsinTerms - 1];
+    for (int i = kAsinTerms - 2; i >= 0; --i) {
+        p = MulAdd<kFma>(p, u, kAsinCoefficients[i]);
+    }
+    const double q = z * p;
+    return reduced ? MulAdd<kFma>(-2.0, q, kHalfPi) : q;
+}
+
+template <bool kFma>
+[[gnu::always_inline]] inline double ComputeDistanceScalar(const PreparedCoordinates& from,
+                                                           const PreparedCoordinates& to) {
+    const double s_lat = Sin<kFma>((to.lat - from.lat) * 0.5);
+    const double s_lng = Sin<kFma>((to.lng - from.lng) * 0.5);
+    const double cos_product = from.cos_lat * to.cos_lat;
+    double h = MulAdd<kFma>(cos_product, s_lng * s_lng, s_lat * s_lat);
+    h = h < 1.0 ? h : 1.0;
+    return 2.0 * EarthRadius * Asin<kFma>(std::sqrt(h));
+}
+
+#ifdef GEO_X86
+__attribute__((target("fma")))
+#endif
+void ComputeDistancesScalarFma(const PreparedCoordinates* from, const PreparedCoordinates* to, double* distances,
+                               size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        distances[i] = ComputeDistanceScalar<true>(from[i], to[i]);
+    }
+}
+
+void ComputeDistancesScalarPlain(const PreparedCoordinates* from, const PreparedCoordinates* to, double* distances,
+                                 size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        distances[i] = ComputeDistanceScalar<false>(from[i], to[i]);
+    }
+}
+
+#ifdef GEO_X86
+
+__attribute__((target("avx2,fma")))
+__m256d SinAvx2(__m256d x) {
+    const __m256d sign_mask = _mm256_set1_pd(-0.0);
+    __m256d t = _mm256_andnot_pd(sign_mask, x);
+    const __m256d reflected = _mm256_sub_pd(_mm256_set1_pd(M_PI), t);
+    t = _mm256_min_pd(t, reflected);
+    const __m256d u = _mm256_mul_pd(t, t);
+    __m256d p = _mm256_set1_pd(kSinCoefficients[kSinTerms - 1]);
+    for (int i = kSinTerms - 2; i >= 0; --i) {
+        p = _mm256_fmadd_pd(p, u, _mm256_set1_pd(kSinCoefficients[i]));
+    }
+    return _mm256_mul_pd(t, p);
+}
+
+__attribute__((target("avx2,fma")))
+__m256d AsinAvx2(__m256d y) {
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d reduced = _mm256_cmp_pd(y, half, _CMP_GT_OQ);
+    const __m256d complement = _mm256_sqrt_pd(_mm256_mul_pd(_mm256_sub_pd(_mm256_set1_pd(1.0), y), half));
+    const __m256d z = _mm256_blendv_pd(y, complement, reduced);
+    const __m256d u = _mm256_mul_pd(z, z);
+    __m256d p = _mm256_set1_pd(kAsinCoefficients[kAsinTerms - 1]);
+    for (int i = kAsinTerms - 2; i >= 0; --i) {
+        p = _mm256_fmadd_pd(p, u, _mm256_set1_pd(kAsinCoefficients[i]));
+    }
+    const __m256d q = _mm256_mul_pd(z, p);
+    const __m256d reflected = _mm256_fmadd_pd(_mm256_set1_pd(-2.0), q, _mm256_set1_pd(kHalfPi));
+    return _mm256_blendv_pd(q, reflected, reduced);
+}
+
+// Координаты четырёх точек из массива структур раскладываются по векторам
+__attribute__((target("avx2,fma")))
+void LoadAvx2(const PreparedCoordinates* points, __m256d& lat, __m256d& lng, __m256d& cos_lat) {
+    static_assert(sizeof(PreparedCoordinates) == 3 * sizeof(double));
+    const double* data = &points->lat;
+    const __m256i index = _mm256_setr_epi64x(0, 3, 6, 9);
+    lat = _mm256_i64gather_pd(data, index, 8);
+    lng = _mm256_i64gather_pd(data + 1, index, 8);
+    cos_lat = _mm256_i64gather_pd(data + 2, index, 8);
+}
+
+__attribute__((target("avx2,fma")))
+__m256d ComputeDistancesAvx2(const PreparedCoordinates* from, const PreparedCoordinates* to) {
+    const __m256d half = _mm256_set1_pd(0.5);
+    __m256d from_lat, from_lng, from_cos;
+    __m256d to_lat, to_lng, to_cos;
+    LoadAvx2(from, from_lat, from_lng, from_cos);
+    LoadAvx2(to, to_lat, to_lng, to_cos);
+    const __m256d s_lat = SinAvx2(_mm256_mul_pd(_mm256_sub_pd(to_lat, from_lat), half));
+    const __m256d s_lng = SinAvx2(_mm256_mul_pd(_mm256_sub_pd(to_lng, from_lng), half));
+    const __m256d cos_product = _mm256_mul_pd(from_cos, to_cos);
+    __m256d h = _mm256_fmadd_pd(cos_product, _mm256_mul_pd(s_lng, s_lng), _mm256_mul_pd(s_lat, s_lat));
+    h = _mm256_min_pd(h, _mm256_set1_pd(1.0));
+    return _mm256_mul_pd(_mm256_set1_pd(2.0 * EarthRadius), AsinAvx2(_mm256_sqrt_pd(h)));
+}
+
+__attribute__((target("avx2,fma")))
+void ComputeDistancesAvx2(const PreparedCoordinates* from, const PreparedCoordinates* to, double* distances,
+                          size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm256_storeu_pd(distances + i, ComputeDistancesAvx2(from + i, to + i));
+    }
+    if (i == count) {
+        return;
+    }
+    // Остаток дополняется последней парой до четырёх: скалярный fma без аппаратной поддержки медленный
+    PreparedCoordinates tail_from[4];
+    PreparedCoordinates tail_to[4];
+    for (size_t j = 0; j < 4; ++j) {
+        tail_from[j] = from[std::min(i + j, count - 1)];
+        tail_to[j] = to[std::min(i + j, count - 1)];
+    }
+    double tail[4];
+    _mm256_storeu_pd(tail, ComputeDistancesAvx2(tail_from, tail_to));
+    std::copy(tail, tail + (count - i), distances + i);
+}
+
+#endif
+
+using DistancesFunction = void (*)(const PreparedCoordinates*, const PreparedCoordinates*, double*, size_t);
+
+bool IsFmaSupported() {
+#ifdef GEO_X86
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("fma");
+#else
+    return true;
+#endif
+}
+
+bool IsAvx2Supported() {
+#ifdef GEO_X86
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && IsFmaSupported();
+#else
+    return false;
+#endif
+}
+
+DistancesFunction SelectComputeDistances(DistanceKernel kernel) {
+    if (!IsSupported(kernel)) {
+        throw std::invalid_argument("distance kernel is not supported by this processor");
+    }
+#ifdef GEO_X86
+    if (kernel == DistanceKernel::Avx2 || (kernel == DistanceKernel::Auto && IsAvx2Supported())) {
+        return ComputeDistancesAvx2;
+    }
+#endif
+    return IsFmaSupported() ? ComputeDistancesScalarFma : ComputeDistancesScalarPlain;
+}
+
+void CheckSizes(std::span<const PreparedCoordinates> from, std::span<const PreparedCoordinates> to,
+                std::span<double> distances) {
+    if (from.size() != to.size() || from.size() != distances.size()) {
+        throw std::invalid_argument("point spans differ in size");
+    }
+}
+
+}
+
+bool IsSupported(DistanceKernel kernel) {
+    return kernel != DistanceKernel::Avx2 || IsAvx2Supported();
+}
+
+void ComputeDistances(std::span<const PreparedCoordinates> from, std::span<const PreparedCoordinates> to,
+                      std::span<double> distances) {
+    CheckSizes(from, to, distances);
+    static const DistancesFunction compute = SelectComputeDistances(DistanceKernel::Auto);
+    compute(from.data(), to.data(), distances.data(), distances.size());
+}
+
+void ComputeDistances(std::span<const PreparedCoordinates> from, std::span<const PreparedCoordinates> to,
+                      std::span<double> distances, DistanceKernel kernel) {
+    CheckSizes(from, to, distances);
+    SelectComputeDistances(kernel)(from.data(), to.data(), distances.data(), distances.size());
+}
+
 }  // namespace geo
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cmath>
+#include <span>
 
 namespace geo {
 
@@ -20,4 +21,31 @@ namespace geo {
 
     double ComputeDistance(Coordinates from, Coordinates to);
 
+    // Координаты в радианах и косинус широты, вычисленные один раз для точки
+    struct PreparedCoordinates {
+        double lat;
+        double lng;
+        double cos_lat;
+    };
+
+    PreparedCoordinates Prepare(Coordinates place);
+
+    // distances[i] - расстояние от from[i] до to[i] по формуле гаверсинусов, погрешность описана в geo.cpp.
+    // Пары обрабатываются по четыре при поддержке AVX2, результат не зависит от набора инструкций
+    void ComputeDistances(std::span<const PreparedCoordinates> from, std::span<const PreparedCoordinates> to,
+                          std::span<double> distances);
+
+    // Реализации ComputeDistances. Auto выбирает AVX2, если процессор его поддерживает, иначе Scalar
+    enum class DistanceKernel {
+        Auto,
+        Scalar,
+        Avx2
+    };
+
+    bool IsSupported(DistanceKernel kernel);
+    // Вычисляет расстояния заданной реализацией, например чтобы сравнить её с другими.
+    // Бросает invalid_argument, если процессор её не поддерживает
+    void ComputeDistances(std::span<const PreparedCoordinates> from, std::span<const PreparedCoordinates> to,
+                          std::span<double> distances, DistanceKernel kernel);
+
 }
@@ -1,8 +1,10 @@
-#include <sstream>
+#include <charconv>
 #include <cstring>
 #include <cctype>
+#include <stdexcept>
 
 #include "json.h"
+#include "text_scan.h"
 
 using namespace std;
 
@@ -10,39 +12,290 @@ namespace json {
 
 namespace {
 
-    
 using Number = std::variant<int, double>;
 
+bool IsSpace(char c) {
+    return std::isspace(static_cast<unsigned char>(c));
+}
+
+// Текст скалярного значения из потока должен быть прочитан целиком, как и при разборе буфера
+void CheckConsumed(const Reader& reader, std::string_view raw) {
+    if (reader.GetPosition() != raw.data() + raw.size()) {
+        throw ParsingError("Unexpected symbol after value"s);
+    }
+}
+
+}
+
+Reader::Reader(std::string_view input)
+    : cur_(input.data())
+    , end_(input.data() + input.size()) {
+}
+
+const char* Reader::GetPosition() const {
+    return cur_;
+}
+
+char Reader::Peek() {
+    SkipSpaces();
+    if (cur_ == end_) {
+        throw ParsingError("Unexpected end of input"s);
+    }
+    return *cur_;
+}
 
-Number LoadNumber(std::istream& input) {
-    using namespace std::literals;
+Node Reader::ReadNode() {
+    const char c = Peek();
+    after_open_ = false;
+    if (c == '[') {
+        ++cur_;
+        return LoadArray();
+    } else if (c == '{') {
+        ++cur_;
+        return LoadDict();
+    } else if (c == '"') {
+        ++cur_;
+        return std::string(LoadString());
+    } else if (c == 'n') {
+        LoadLiteral("null"sv);
+        return Node{};
+    } else if (c == 't') {
+        LoadLiteral("true"sv);
+        return Node{true};
+    } else if (c == 'f') {
+        LoadLiteral("false"sv);
+        return Node{false};
+    }
+    const auto number = LoadNumber();
+    if (const int* int_val = std::get_if<int>(&number)) {
+        return Node(*int_val);
+    }
+    return Node(std::get<double>(number));
+}
 
-    std::string parsed_num;
+void Reader::Parse(Handler& handler) {
+    const char c = Peek();
+    after_open_ = false;
+    if (c == '[') {
+        ++cur_;
+        handler.StartArray();
+        if (!TryClose(']')) {
+            do {
+                Parse(handler);
+            } while (NextSeparator(']'));
+        }
+        handler.EndArray();
+    } else if (c == '{') {
+        ++cur_;
+        handler.StartObject();
+        if (!TryClose('}')) {
+            do {
+                handler.Key(LoadKey());
+                Parse(handler);
+            } while (NextSeparator('}'));
+        }
+        handler.EndObject();
+    } else if (c == '"') {
+        ++cur_;
+        handler.String(LoadString());
+    } else if (c == 'n') {
+        LoadLiteral("null"sv);
+        handler.Null();
+    } else if (c == 't') {
+        LoadLiteral("true"sv);
+        handler.Bool(true);
+    } else if (c == 'f') {
+        LoadLiteral("false"sv);
+        handler.Bool(false);
+    } else {
+        const auto number = LoadNumber();
+        if (const int* int_val = std::get_if<int>(&number)) {
+            handler.Int(*int_val);
+        } else {
+            handler.Double(std::get<double>(number));
+        }
+    }
+}
 
-    // Считывает в parsed_num очередной символ из input
-    auto read_char = [&parsed_num, &input] {
-        parsed_num += static_cast<char>(input.get());
-        if (!input) {
-            throw json::ParsingError("Failed to read number from stream"s);
+std::string_view Reader::SkipRaw() {
+    const char c = Peek();
+    const char* begin = cur_;
+    if (c != '[' && c != '{') {
+        Skip();
+        return {begin, static_cast<size_t>(cur_ - begin)};
+    }
+    after_open_ = false;
+    size_t depth = 0;
+    do {
+        cur_ = text_scan::FindJsonStructural(cur_, end_);
+        if (cur_ == end_) {
+            throw ParsingError("Unexpected end of input"s);
         }
-    };
+        const char s = *cur_++;
+        if (s == '"') {
+            for (;;) {
+                cur_ = text_scan::FindJsonStringSpecial(cur_, end_);
+                if (cur_ == end_) {
+                    throw ParsingError("String parsing error"s);
+                }
+                const char q = *cur_++;
+                if (q == '"') {
+                    break;
+                }
+                if (q == '\\' && cur_ != end_) {
+                    ++cur_;
+                }
+            }
+        } else if (s == '[' || s == '{') {
+            ++depth;
+        } else {
+            --depth;
+        }
+    } while (depth > 0);
+    return {begin, static_cast<size_t>(cur_ - begin)};
+}
+
+void Reader::Skip() {
+    const char c = Peek();
+    after_open_ = false;
+    if (c == '[') {
+        ++cur_;
+        if (!TryClose(']')) {
+            do {
+                Skip();
+            } while (NextSeparator(']'));
+        }
+    } else if (c == '{') {
+        ++cur_;
+        if (!TryClose('}')) {
+            do {
+                LoadKey();
+                Skip();
+            } while (NextSeparator('}'));
+        }
+    } else if (c == '"') {
+        ++cur_;
+        LoadString();
+    } else if (c == 'n') {
+        LoadLiteral("null"sv);
+    } else if (c == 't') {
+        LoadLiteral("true"sv);
+    } else if (c == 'f') {
+        LoadLiteral("false"sv);
+    } else {
+        LoadNumber();
+    }
+}
+
+std::string_view Reader::ReadString() {
+    if (Peek() != '"') {
+        throw ParsingError("String is expected"s);
+    }
+    ++cur_;
+    after_open_ = false;
+    return LoadString();
+}
+
+int Reader::ReadInt() {
+    Peek();
+    after_open_ = false;
+    const auto number = LoadNumber();
+    if (const int* int_val = std::get_if<int>(&number)) {
+        return *int_val;
+    }
+    throw ParsingError("Integer is expected"s);
+}
+
+double Reader::ReadDouble() {
+    Peek();
+    after_open_ = false;
+    const auto number = LoadNumber();
+    if (const int* int_val = std::get_if<int>(&number)) {
+        return *int_val;
+    }
+    return std::get<double>(number);
+}
+
+bool Reader::ReadBool() {
+    const char c = Peek();
+    after_open_ = false;
+    if (c == 't') {
+        LoadLiteral("true"sv);
+        return true;
+    }
+    LoadLiteral("false"sv);
+    return false;
+}
+
+void Reader::StartObject() {
+    if (Peek() != '{') {
+        throw ParsingError("Dict is expected"s);
+    }
+    ++cur_;
+    after_open_ = true;
+}
+
+bool Reader::NextKey(std::string_view& key) {
+    if (after_open_ ? TryClose('}') : !NextSeparator('}')) {
+        after_open_ = false;
+        return false;
+    }
+    after_open_ = false;
+    key = LoadKey();
+    return true;
+}
+
+void Reader::StartArray() {
+    if (Peek() != '[') {
+        throw ParsingError("Array is expected"s);
+    }
+    ++cur_;
+    after_open_ = true;
+}
+
+bool Reader::NextElement() {
+    const bool has_next = after_open_ ? !TryClose(']') : NextSeparator(']');
+    after_open_ = false;
+    return has_next;
+}
+
+void Reader::SkipSpaces() {
+    while (cur_ != end_ && IsSpace(*cur_)) {
+        ++cur_;
+    }
+}
+
+char Reader::NextChar() {
+    SkipSpaces();
+    if (cur_ == end_) {
+        throw ParsingError("Unexpected end of input"s);
+    }
+    return *cur_++;
+}
 
-    // Считывает одну или более цифр в parsed_num из input
-    auto read_digits = [&input, read_char] {
-        if (!std::isdigit(input.peek())) {
-            throw json::ParsingError("A digit is expected"s);
+bool Reader::IsDigit() const {
+    return cur_ != end_ && std::isdigit(static_cast<unsigned char>(*cur_));
+}
+
+Reader::Number Reader::LoadNumber() {
+    const char* begin = cur_;
+
+    // Считывает одну или более цифр
+    auto read_digits = [this] {
+        if (!IsDigit()) {
+            throw ParsingError("A digit is expected"s);
         }
-        while (std::isdigit(input.peek())) {
-            read_char();
+        while (IsDigit()) {
+            ++cur_;
         }
     };
 
-    if (input.peek() == '-') {
-        read_char();
+    if (cur_ != end_ && *cur_ == '-') {
+        ++cur_;
     }
     // Парсим целую часть числа
-    if (input.peek() == '0') {
-        read_char();
+    if (cur_ != end_ && *cur_ == '0') {
+        ++cur_;
         // После 0 в JSON не могут идти другие цифры
     } else {
         read_digits();
@@ -50,218 +303,163 @@ Number LoadNumber(std::istream& input) {
 
     bool is_int = true;
     // Парсим дробную часть числа
-    if (input.peek() == '.') {
-        read_char();
+    if (cur_ != end_ && *cur_ == '.') {
+        ++cur_;
         read_digits();
         is_int = false;
     }
 
     // Парсим экспоненциальную часть числа
-    if (int ch = input.peek(); ch == 'e' || ch == 'E') {
-        read_char();
-        if (ch = input.peek(); ch == '+' || ch == '-') {
-            read_char();
+    if (cur_ != end_ && (*cur_ == 'e' || *cur_ == 'E')) {
+        ++cur_;
+        if (cur_ != end_ && (*cur_ == '+' || *cur_ == '-')) {
+            ++cur_;
         }
         read_digits();
         is_int = false;
     }
 
-    try {
-        if (is_int) {
-            // Сначала пробуем преобразовать строку в int
-            try {
-                return std::stoi(parsed_num);
-            } catch (...) {
-                // В случае неудачи, например, при переполнении,
-                // код ниже попробует преобразовать строку в double
-            }
+    // Число преобразуется прямо во входном буфере, без копирования и исключений
+    if (is_int) {
+        int value = 0;
+        const auto [ptr, ec] = std::from_chars(begin, cur_, value);
+        if (ec == std::errc{} && ptr == cur_) {
+            return value;
         }
-        return std::stod(parsed_num);
-    } catch (...) {
-        throw json::ParsingError("Failed to convert "s + parsed_num + " to number"s);
+        // Целое, не поместившееся в int, читается как double
+    }
+    double value = 0.0;
+    const auto [ptr, ec] = std::from_chars(begin, cur_, value);
+    if (ec != std::errc{} || ptr != cur_) {
+        throw ParsingError("Failed to convert "s + std::string(begin, cur_) + " to number"s);
     }
+    return value;
 }
 
-// Считывает содержимое строкового литерала JSON-документа
-// Функцию следует использовать после считывания открывающего символа ":
-std::string LoadString(std::istream& input) {
-    using namespace std::literals;
-    
-    auto it = std::istreambuf_iterator<char>(input);
-    auto end = std::istreambuf_iterator<char>();
-    std::string s;
+std::string_view Reader::LoadString() {
+    const char* begin = cur_;
+    SkipPlainChars();
+    if (cur_ != end_ && *cur_ == '"') {
+        return {begin, static_cast<size_t>(cur_++ - begin)};
+    }
+    scratch_.assign(begin, cur_);
     while (true) {
-        if (it == end) {
+        if (cur_ == end_) {
             // Поток закончился до того, как встретили закрывающую кавычку?
-            throw json::ParsingError("String parsing error");
+            throw ParsingError("String parsing error"s);
         }
-        const char ch = *it;
+        const char ch = *cur_++;
         if (ch == '"') {
             // Встретили закрывающую кавычку
-            ++it;
             break;
         } else if (ch == '\\') {
             // Встретили начало escape-последовательности
-            ++it;
-            if (it == end) {
+            if (cur_ == end_) {
                 // Поток завершился сразу после символа обратной косой черты
-                throw json::ParsingError("String parsing error");
+                throw ParsingError("String parsing error"s);
             }
-            const char escaped_char = *(it);
+            const char escaped_char = *cur_++;
             // Обрабатываем одну из последовательностей: \\, \n, \t, \r, \"
             switch (escaped_char) {
                 case 'n':
-                    s.push_back('\n');
+                    scratch_.push_back('\n');
                     break;
                 case 't':
-                    s.push_back('\t');
+                    scratch_.push_back('\t');
                     break;
                 case 'r':
-                    s.push_back('\r');
+                    scratch_.push_back('\r');
                     break;
                 case '"':
-                    s.push_back('"');
+                    scratch_.push_back('"');
                     break;
                 case '\\':
-                    s.push_back('\\');
+                    scratch_.push_back('\\');
                     break;
                 default:
                     // Встретили неизвестную escape-последовательность
-                    throw json::ParsingError("Unrecognized escape sequence \\"s + escaped_char);
+                    throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
             }
-        } else if (ch == '\n' || ch == '\r') {
-            // Строковый литерал внутри- JSON не может прерываться символами \r или \n
-            throw json::ParsingError("Unexpected end of line"s);
         } else {
-            // Просто считываем очередной символ и помещаем его в результирующую строку
-            s.push_back(ch);
+            // Строковый литерал внутри JSON не может прерываться символами \r или \n
+            throw ParsingError("Unexpected end of line"s);
         }
-        ++it;
+        // Копируем целиком участок без спецсимволов
+        const char* run = cur_;
+        SkipPlainChars();
+        scratch_.append(run, cur_);
     }
-
-    return s;
+    return scratch_;
 }
 
-Node LoadNode(istream& input);
-
-Node LoadArray(istream& input) {
-    Array result;
-    char c;
-    for (; input >> c && c != ']';) {
-        if (c != ',') {
-            input.putback(c);
-        }
-        result.push_back(LoadNode(input));
-    }
+void Reader::SkipPlainChars() {
+    cur_ = text_scan::FindJsonStringSpecial(cur_, end_);
+}
 
-    if (c != ']') {
-        throw ParsingError("");
+void Reader::LoadLiteral(std::string_view literal) {
+    if (static_cast<size_t>(end_ - cur_) < literal.size()
+        || std::string_view(cur_, literal.size()) != literal) {
+        throw ParsingError("Unknown literal"s);
     }
-    return Node(move(result));
-}
-    
-bool CheckString(const std::string& str, istream& input) {
-    for (const char ch : str) {
-        if (ch != static_cast<char>(input.get())) {
-            return false;
+    cur_ += literal.size();
+    if (cur_ != end_) {
+        const char sep = *cur_;
+        if (!IsSpace(sep) && sep != ',' && sep != '}' && sep != ']') {
+            throw ParsingError("Unknown literal"s);
         }
     }
-    return true;
 }
-    
-bool CheckSep(char sep) {
-    if (std::isspace(sep) ||  sep == ',' ||  sep == '}'||  sep == ']'){
+
+bool Reader::TryClose(char close) {
+    SkipSpaces();
+    if (cur_ != end_ && *cur_ == close) {
+        ++cur_;
         return true;
     }
     return false;
 }
-    
-bool CheckSep(istream& input) {
-    char sep = static_cast<char>(input.get());
-    if (!std::isprint(sep) || std::isblank(sep)) {
+
+bool Reader::NextSeparator(char close) {
+    const char c = NextChar();
+    if (c == ',') {
         return true;
     }
-    input.putback(sep);
-    return CheckSep(sep);
-}
-    
-Node LoadNull(istream& input) {
-    if (!CheckString("null"s, input) || !CheckSep(input)) {
-        throw ParsingError("");
+    if (c != close) {
+        throw ParsingError("Unexpected symbol in container"s);
     }
-    
-    return Node{};
+    return false;
 }
-    
-Node LoadFalse(istream& input) {
-    if(!CheckString("false"s, input) || !CheckSep(input)){
-        throw ParsingError("");
+
+std::string_view Reader::LoadKey() {
+    if (NextChar() != '"') {
+        throw ParsingError("Dict key is expected"s);
     }
-    return Node{false};
-}
-    
-Node LoadTrue(istream& input) {
-    if(!CheckString("true"s, input) || !CheckSep(input)){
-        throw ParsingError("");
+    const auto key = LoadString();
+    if (NextChar() != ':') {
+        throw ParsingError("Dict parsing error"s);
     }
-    return Node{true};
+    return key;
 }
 
-Node LoadDict(istream& input) {
-    Dict result;
-    char c;
-    for (; input >> c && c != '}';) {
-        if (c == ',') {
-            input >> c;
-        }
-
-        string key = LoadString(input);
-        input >> c;
-        result.insert({move(key), LoadNode(input)});
-    }
-    if (c != '}') {
-        throw ParsingError("");
+Node Reader::LoadArray() {
+    Array result;
+    if (!TryClose(']')) {
+        do {
+            result.push_back(ReadNode());
+        } while (NextSeparator(']'));
     }
     return Node(move(result));
 }
 
-Node LoadNode(istream& input) {
-    char c;
-    input >> c;
-    
-    while (std::isspace(c) && input >> c) {
-        //
-    }
-    
-    if (c == '[') {
-        return LoadArray(input);
-    } else if (c == '{') {
-        return LoadDict(input);
-    } else if (c == '"') {
-        return LoadString(input);
-    } else if (c == 'n') {
-        input.putback(c);
-        return LoadNull(input);
-    } else if (c == 't') {
-        input.putback(c);
-        return LoadTrue(input);
-    } else if(c == 'f') {
-        input.putback(c);
-        return LoadFalse(input);
-    } else {
-        input.putback(c);
-        const auto number = LoadNumber(input);
-        const int* int_val = std::get_if<int>(&number);
-        if (int_val != nullptr) {
-            return Node(*int_val);
-        }
-        const double* dbl_val = std::get_if<double>(&number);
-        if (dbl_val != nullptr) {
-            return Node(*dbl_val);
-        }
-        throw ParsingError("");
+Node Reader::LoadDict() {
+    Dict result;
+    if (!TryClose('}')) {
+        do {
+            string key(LoadKey());
+            result.insert({move(key), ReadNode()});
+        } while (NextSeparator('}'));
     }
-}
+    return Node(move(result));
 }
     
 Node::NodeType Node::GetType() const {
@@ -378,73 +576,353 @@ const Node& Document::GetRoot() const {
     return root_;
 }
 
+Document Load(std::string_view input) {
+    return Document{Reader(input).ReadNode()};
+}
+
 Document Load(istream& input) {
-    return Document{LoadNode(input)};
+    return Document{StreamReader(input).ReadNode()};
 }
 
-// Перегрузка функции PrintValue для вывода значений null
-void PrintValue(const bool& value, const PrintContext& ctx) {
-    if (value) {
-        ctx.out << "true"sv;
+void Parse(std::string_view input, Handler& handler) {
+    Reader(input).Parse(handler);
+}
+
+void Parse(istream& input, Handler& handler) {
+    StreamReader(input).Parse(handler);
+}
+
+StreamReader::StreamReader(std::istream& input, size_t chunk_size)
+    : input_(input)
+    , chunk_size_(chunk_size) {
+}
+
+char StreamReader::Peek() {
+    if (!SkipSpaces()) {
+        throw ParsingError("Unexpected end of input"s);
+    }
+    return buffer_[pos_];
+}
+
+Node StreamReader::ReadNode() {
+    const char c = Peek();
+    if (c == '[') {
+        StartArray();
+        Array result;
+        while (NextElement()) {
+            result.push_back(ReadNode());
+        }
+        return Node(move(result));
+    } else if (c == '{') {
+        StartObject();
+        Dict result;
+        string key;
+        while (NextKey(key)) {
+            result.insert({key, ReadNode()});
+        }
+        return Node(move(result));
+    }
+    const std::string_view raw = ReadRaw();
+    Reader reader(raw);
+    Node result = reader.ReadNode();
+    CheckConsumed(reader, raw);
+    return result;
+}
+
+void StreamReader::Parse(Handler& handler) {
+    const char c = Peek();
+    if (c == '[') {
+        StartArray();
+        handler.StartArray();
+        while (NextElement()) {
+            Parse(handler);
+        }
+        handler.EndArray();
+    } else if (c == '{') {
+        StartObject();
+        handler.StartObject();
+        string key;
+        while (NextKey(key)) {
+            handler.Key(key);
+            Parse(handler);
+        }
+        handler.EndObject();
     } else {
-        ctx.out << "false"sv;
+        const std::string_view raw = ReadRaw();
+        Reader reader(raw);
+        reader.Parse(handler);
+        CheckConsumed(reader, raw);
+    }
+}
+
+void StreamReader::Skip() {
+    ScanValue(false);
+}
+
+std::string_view StreamReader::ReadRaw() {
+    const size_t begin = ScanValue(true);
+    return std::string_view(buffer_).substr(begin, pos_ - begin);
+}
+
+void StreamReader::StartObject() {
+    if (Peek() != '{') {
+        throw ParsingError("Dict is expected"s);
+    }
+    ++pos_;
+    after_open_ = true;
+}
+
+bool StreamReader::NextKey(std::string& key) {
+    if (after_open_ ? TryClose('}') : !NextSeparator('}')) {
+        after_open_ = false;
+        return false;
+    }
+    after_open_ = false;
+    if (Peek() != '"') {
+        throw ParsingError("Dict key is expected"s);
+    }
+    key = Reader(ReadRaw()).ReadString();
+    if (NextChar() != ':') {
+        throw ParsingError("Dict parsing error"s);
+    }
+    return true;
+}
+
+void StreamReader::StartArray() {
+    if (Peek() != '[') {
+        throw ParsingError("Array is expected"s);
+    }
+    ++pos_;
+    after_open_ = true;
+}
+
+bool StreamReader::NextElement() {
+    const bool has_next = after_open_ ? !TryClose(']') : NextSeparator(']');
+    after_open_ = false;
+    return has_next;
+}
+
+bool StreamReader::Fill(size_t keep_from) {
+    buffer_.erase(0, keep_from);
+    pos_ -= keep_from;
+    const size_t size = buffer_.size();
+    buffer_.resize(size + chunk_size_);
+    input_.read(buffer_.data() + size, static_cast<streamsize>(chunk_size_));
+    buffer_.resize(size + static_cast<size_t>(input_.gcount()));
+    return buffer_.size() > size;
+}
+
+bool StreamReader::SkipSpaces() {
+    for (;;) {
+        while (pos_ < buffer_.size() && IsSpace(buffer_[pos_])) {
+            ++pos_;
+        }
+        if (pos_ < buffer_.size()) {
+            return true;
+        }
+        if (!Fill(pos_)) {
+            return false;
+        }
+    }
+}
+
+char StreamReader::NextChar() {
+    const char c = Peek();
+    ++pos_;
+    return c;
+}
+
+bool StreamReader::TryClose(char close) {
+    if (SkipSpaces() && buffer_[pos_] == close) {
+        ++pos_;
+        return true;
+    }
+    return false;
+}
+
+bool StreamReader::NextSeparator(char close) {
+    const char c = NextChar();
+    if (c == ',') {
+        return true;
+    }
+    if (c != close) {
+        throw ParsingError("Unexpected symbol in container"s);
+    }
+    return false;
+}
+
+size_t StreamReader::ScanValue(bool keep) {
+    const char c = Peek();
+    after_open_ = false;
+    size_t begin = pos_;
+    // Дочитывает поток, сохраняя начало значения или отбрасывая уже пройденную часть.
+    // Fill сдвигает буфер и тогда, когда поток закончился, поэтому начало обновляется всегда
+    auto fill = [&]() {
+        const bool filled = Fill(keep ? begin : pos_);
+        begin = keep ? 0 : pos_;
+        return filled;
+    };
+
+    if (c != '[' && c != '{' && c != '"') {
+        // Число или литерал продолжается до разделителя или конца потока
+        for (;;) {
+            while (pos_ < buffer_.size()) {
+                const char s = buffer_[pos_];
+                if (IsSpace(s) || s == ',' || s == '}' || s == ']') {
+                    return begin;
+                }
+                ++pos_;
+            }
+            if (!fill()) {
+                return begin;
+            }
+        }
+    }
+
+    size_t depth = 0;
+    bool in_string = false;
+    bool escaped = false;
+    for (;;) {
+        if (pos_ == buffer_.size() && !fill()) {
+            throw ParsingError("Unexpected end of input"s);
+        }
+        const char* data = buffer_.data();
+        const char* end = data + buffer_.size();
+        if (escaped) {
+            escaped = false;
+            ++pos_;
+            continue;
+        }
+        pos_ = (in_string ? text_scan::FindJsonStringSpecial(data + pos_, end)
+                          : text_scan::FindJsonStructural(data + pos_, end)) - data;
+        if (pos_ == buffer_.size()) {
+            continue;
+        }
+        const char s = buffer_[pos_++];
+        if (in_string) {
+            if (s == '\\') {
+                escaped = true;
+            } else if (s == '"') {
+                in_string = false;
+                if (depth == 0) {
+                    return begin;
+                }
+            }
+        } else if (s == '"') {
+            in_string = true;
+        } else if (s == '[' || s == '{') {
+            ++depth;
+        } else if (--depth == 0) {
+            return begin;
+        }
+    }
+}
+
+void PrintContext::PrintIndent() const {
+    if (mode == PrintMode::Pretty) {
+        out.append(static_cast<size_t>(indent), ' ');
+    }
+}
+
+void PrintContext::PrintNewLine() const {
+    if (mode == PrintMode::Pretty) {
+        out.push_back('\n');
     }
 }
 
+void PrintValue(int value, const PrintContext& ctx) {
+    char buffer[16];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    ctx.out.append(buffer, result.ptr);
+}
+
+void PrintValue(double value, const PrintContext& ctx) {
+    // Кратчайшее представление, которое читается обратно в то же самое число
+    char buffer[32];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    ctx.out.append(buffer, result.ptr);
+}
+
+void PrintValue(bool value, const PrintContext& ctx) {
+    ctx.out.append(value ? "true"sv : "false"sv);
+}
+
+// Перегрузка функции PrintValue для вывода значений null
 void PrintValue(std::nullptr_t, const PrintContext& ctx) {
-    ctx.out << "null"sv;
+    ctx.out.append("null"sv);
 }
 
-void PrintValue(const std::string& value, const PrintContext& ctx) {
-    ctx.out << "\""sv;
-    for (const char c : value) {
+void PrintValue(std::string_view value, const PrintContext& ctx) {
+    auto& out = ctx.out;
+    out.push_back('"');
+    const char* cur = value.data();
+    const char* end = cur + value.size();
+    while (true) {
+        // Участки без спецсимволов копируются целиком
+        const char* special = text_scan::FindJsonEscape(cur, end);
+        out.append(cur, special);
+        if (special == end) {
+            break;
+        }
+        const char c = *special;
         if (c == '\\') {
-            ctx.out << "\\\\";
+            out.append("\\\\"sv);
         } else if (c == '"') {
-            ctx.out << "\\\"";
+            out.append("\\\""sv);
         } else if (c == '\r') {
-            ctx.out << "\\r";
+            out.append("\\r"sv);
         } else if (c == '\n') {
-            ctx.out << "\\n";
-        } else if (c == '\t') {
-            ctx.out << "\\t";
+            out.append("\\n"sv);
         } else {
-            ctx.out << c;
+            out.append("\\t"sv);
         }
+        cur = special + 1;
     }
-    ctx.out << "\""sv;
+    out.push_back('"');
+}
+
+void PrintValue(const std::string& value, const PrintContext& ctx) {
+    PrintValue(std::string_view(value), ctx);
 }
 
 void PrintValue(const Array& arr, const PrintContext& ctx) {
-    ctx.out << "["sv << std::endl;
+    ctx.out.push_back('[');
+    ctx.PrintNewLine();
     bool comma = false;
     for (const auto& val : arr) {
         if (comma) {
-            ctx.out << ","sv << std::endl;
+            ctx.out.push_back(',');
+            ctx.PrintNewLine();
         } else {
             comma = true;
         }
         ctx.Indented().PrintIndent();
         PrintValue(val, ctx);
     }
-    ctx.out << std::endl;
-    ctx.PrintIndent() << "]"sv;
+    ctx.PrintNewLine();
+    ctx.PrintIndent();
+    ctx.out.push_back(']');
 }
 
 void PrintValue(const Dict& dict, const PrintContext& ctx) {
-    ctx.out << "{"sv << std::endl;
+    ctx.out.push_back('{');
+    ctx.PrintNewLine();
     bool comma = false;
     for (const auto& [key, val] : dict) {
         if (comma) {
-            ctx.out << ","sv << std::endl;
+            ctx.out.push_back(',');
+            ctx.PrintNewLine();
         } else {
             comma = true;
         }
-        ctx.Indented().PrintIndent() << "\"" << key << "\" : "sv;
+        ctx.Indented().PrintIndent();
+        PrintValue(key, ctx);
+        ctx.out.append(ctx.mode == PrintMode::Pretty ? " : "sv : ":"sv);
         PrintValue(val, ctx);
     }
-    ctx.out << std::endl;
-    ctx.PrintIndent() << "}"sv;
+    ctx.PrintNewLine();
+    ctx.PrintIndent();
+    ctx.out.push_back('}');
 }
     
 void PrintValue(const Node& node, const PrintContext& ctx) {
@@ -457,11 +935,150 @@ void PrintNode(const Node& node, const PrintContext& ctx) {
         node.GetValue());
 }
 
+void Print(const Document& doc, std::string& buffer, PrintMode mode) {
+    PrintNode(doc.GetRoot(), PrintContext {buffer, mode});
+}
 
-void Print(const Document& doc, std::ostream& output) {
-    PrintNode(doc.GetRoot(), PrintContext {output});
-}  // namespace json
+void Print(const Document& doc, std::ostream& output, PrintMode mode) {
+    // Документ целиком форматируется в памяти и выводится одной операцией записи
+    std::string buffer;
+    Print(doc, buffer, mode);
+    output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
+
+Writer::Writer(std::string& out, PrintMode mode)
+    : out_(out)
+    , mode_(mode) {
+}
+
+PrintContext Writer::GetContext() const {
+    return {out_, mode_, 4, 4 * depth_};
+}
+
+void Writer::BeforeValue() {
+    if (after_key_) {
+        after_key_ = false;
+        return;
+    }
+    if (depth_ == 0) {
+        return;
+    }
+    const uint64_t bit = uint64_t {1} << (depth_ - 1);
+    if (has_items_ & bit) {
+        out_.push_back(',');
+        GetContext().PrintNewLine();
+    }
+    has_items_ |= bit;
+    GetContext().PrintIndent();
+}
 
+void Writer::Open(char bracket) {
+    if (depth_ == 64) {
+        throw std::logic_error("JSON nesting is too deep"s);
+    }
+    BeforeValue();
+    out_.push_back(bracket);
+    ++depth_;
+    has_items_ &= ~(uint64_t {1} << (depth_ - 1));
+    GetContext().PrintNewLine();
+}
+
+void Writer::Close(char bracket) {
+    if (depth_ == 0 || after_key_) {
+        throw std::logic_error("Unexpected end of container"s);
+    }
+    --depth_;
+    const auto ctx = GetContext();
+    ctx.PrintNewLine();
+    ctx.PrintIndent();
+    out_.push_back(bracket);
+}
+
+Writer& Writer::StartArray() {
+    Open('[');
+    return *this;
+}
+
+Writer& Writer::EndArray() {
+    Close(']');
+    return *this;
+}
+
+Writer& Writer::StartDict() {
+    Open('{');
+    return *this;
+}
+
+Writer& Writer::EndDict() {
+    Close('}');
+    return *this;
+}
+
+Writer& Writer::Key(std::string_view key) {
+    BeforeValue();
+    PrintValue(key, GetContext());
+    out_.append(mode_ == PrintMode::Pretty ? " : "sv : ":"sv);
+    after_key_ = true;
+    return *this;
+}
+
+Writer& Writer::Value(int value) {
+    BeforeValue();
+    PrintValue(value, GetContext());
+    return *this;
+}
+
+Writer& Writer::Value(double value) {
+    BeforeValue();
+    PrintValue(value, GetContext());
+    return *this;
+}
+
+Writer& Writer::Value(bool value) {
+    BeforeValue();
+    PrintValue(value, GetContext());
+    return *this;
+}
+
+Writer& Writer::Value(std::nullptr_t) {
+    BeforeValue();
+    PrintValue(nullptr, GetContext());
+    return *this;
+}
+
+Writer& Writer::Value(std::string_view value) {
+    BeforeValue();
+    PrintValue(value, GetContext());
+    return *this;
+}
+
+Writer& Writer::Value(const char* value) {
+    return Value(std::string_view(value));
+}
+
+Writer& Writer::Value(const Node& value) {
+    BeforeValue();
+    PrintNode(value, GetContext());
+    return *this;
+}
+
+Writer Writer::Fork(std::string& out, bool continues) const {
+    if (depth_ == 0 || after_key_) {
+        throw std::logic_error("Only container elements can be written separately"s);
+    }
+    Writer part(out, mode_);
+    part.depth_ = depth_;
+    part.has_items_ = continues ? uint64_t {1} << (depth_ - 1) : 0;
+    return part;
+}
+
+Writer& Writer::Append(std::string_view part) {
+    if (!part.empty()) {
+        out_.append(part);
+        has_items_ |= uint64_t {1} << (depth_ - 1);
+    }
+    return *this;
+}
 
 bool Document::operator== (const Document& other) {
     return GetRoot() == other.GetRoot();
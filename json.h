@@ -1,8 +1,10 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
 #include <map>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <variant>
 
@@ -110,37 +112,179 @@ private:
     Node root_;
 };
 
+// Разбирает документ, целиком расположенный в памяти (например, в отображённом файле)
+Document Load(std::string_view input);
 Document Load(std::istream& input);
 
+/*
+ * Обработчик событий потокового разбора JSON.
+ * Вызовы следуют в порядке появления элементов во входных данных, дерево Node не строится.
+ * Строки и ключи передаются как string_view, действительные только на время вызова
+ */
+class Handler {
+public:
+    virtual void StartObject() = 0;
+    virtual void EndObject() = 0;
+    virtual void StartArray() = 0;
+    virtual void EndArray() = 0;
+    virtual void Key(std::string_view key) = 0;
+    virtual void String(std::string_view value) = 0;
+    virtual void Int(int value) = 0;
+    virtual void Double(double value) = 0;
+    virtual void Bool(bool value) = 0;
+    virtual void Null() = 0;
+
+    virtual ~Handler() = default;
+};
+
+void Parse(std::string_view input, Handler& handler);
+void Parse(std::istream& input, Handler& handler);
+
+/*
+ * Последовательное чтение JSON из непрерывного буфера.
+ * Позволяет разбирать документ по частям, пропуская ненужные значения,
+ * без построения дерева Node. Строки возвращаются как string_view на входной буфер
+ * либо на внутренний буфер, действительный до следующего чтения строки.
+ * Копия Reader продолжает чтение с той же позиции независимо от оригинала
+ */
+class Reader {
+public:
+    explicit Reader(std::string_view input);
+
+    // Возвращает первый значащий символ очередного значения, не считывая его
+    char Peek();
+    const char* GetPosition() const;
+
+    Node ReadNode();
+    // Разбирает очередное значение, сообщая о его элементах обработчику
+    void Parse(Handler& handler);
+    void Skip();
+    // Пропускает значение, проверяя только парность скобок вне строк, и возвращает его текст.
+    // Быстрее Skip, но содержимое значения нужно разобрать отдельно
+    std::string_view SkipRaw();
+
+    std::string_view ReadString();
+    int ReadInt();
+    double ReadDouble();
+    bool ReadBool();
+
+    void StartObject();
+    // Считывает следующий ключ словаря. Возвращает false, когда словарь закончился
+    bool NextKey(std::string_view& key);
+    void StartArray();
+    // Переходит к следующему элементу массива. Возвращает false, когда массив закончился
+    bool NextElement();
+
+private:
+    using Number = std::variant<int, double>;
+
+    void SkipSpaces();
+    // Пропускает пробельные символы и возвращает очередной значащий символ
+    char NextChar();
+    bool IsDigit() const;
+    Number LoadNumber();
+    // Считывает содержимое строкового литерала после открывающего символа "
+    std::string_view LoadString();
+    void SkipPlainChars();
+    // Литерал должен завершаться разделителем или концом входных данных
+    void LoadLiteral(std::string_view literal);
+    // Проверяет, закрывается ли контейнер сразу после открывающей скобки
+    bool TryClose(char close);
+    // Считывает разделитель элементов контейнера. Возвращает false, если контейнер закончился
+    bool NextSeparator(char close);
+    // Считывает ключ словаря вместе с последующим двоеточием
+    std::string_view LoadKey();
+    Node LoadArray();
+    Node LoadDict();
+
+    const char* cur_;
+    const char* end_;
+    // Только что открыт контейнер: перед первым элементом не ожидается запятая
+    bool after_open_ = false;
+    std::string scratch_;
+};
+
+/*
+ * Последовательное чтение JSON из потока кусками по chunk_size байт.
+ * В памяти держится только непрочитанный остаток куска и текст текущего значения,
+ * поэтому большой массив можно разобрать поэлементно, не читая документ целиком.
+ * Содержимое отдельных значений разбирается через Reader по тексту из ReadRaw
+ */
+class StreamReader {
+public:
+    static constexpr size_t kDefaultChunkSize = 64 * 1024;
+
+    explicit StreamReader(std::istream& input, size_t chunk_size = kDefaultChunkSize);
+
+    // Возвращает первый значащий символ очередного значения, не считывая его
+    char Peek();
+
+    Node ReadNode();
+    // Разбирает очередное значение, сообщая о его элементах обработчику.
+    // Контейнеры разбираются по мере чтения, целиком в памяти держатся только простые значения
+    void Parse(Handler& handler);
+    void Skip();
+    // Считывает очередное значение и возвращает его текст, действительный до следующего чтения
+    std::string_view ReadRaw();
 
-// Контекст вывода, хранит ссылку на поток вывода и текущий отсуп
+    void StartObject();
+    // Считывает следующий ключ словаря. Возвращает false, когда словарь закончился
+    bool NextKey(std::string& key);
+    void StartArray();
+    // Переходит к следующему элементу массива. Возвращает false, когда массив закончился
+    bool NextElement();
+
+private:
+    // Отбрасывает начало буфера до позиции keep_from и дочитывает очередной кусок.
+    // Возвращает false, если поток закончился
+    bool Fill(size_t keep_from);
+    // Пропускает пробельные символы. Возвращает false в конце потока
+    bool SkipSpaces();
+    char NextChar();
+    bool TryClose(char close);
+    bool NextSeparator(char close);
+    // Проходит очередное значение и возвращает позицию его начала в буфере.
+    // Если keep равен false, прочитанная часть значения не сохраняется
+    size_t ScanValue(bool keep);
+
+    std::istream& input_;
+    size_t chunk_size_;
+    std::string buffer_;
+    size_t pos_ = 0;
+    bool after_open_ = false;
+};
+
+
+enum class PrintMode {
+    // С переводами строк и отступами
+    Pretty,
+    // Без пробельных символов
+    Compact
+};
+
+// Контекст вывода, хранит ссылку на буфер вывода, режим и текущий отступ
 struct PrintContext {
-    std::ostream& out;
+    std::string& out;
+    PrintMode mode = PrintMode::Pretty;
     int indent_step = 4;
     int indent = 0;
 
-    std::ostream& PrintIndent() const {
-        for (int i = 0; i < indent; ++i) {
-            out.put(' ');
-        }
-        return out;
-    }
+    void PrintIndent() const;
+    void PrintNewLine() const;
 
     // Возвращает новый контекст вывода с увеличенным смещением
     PrintContext Indented() const {
-        return {out, indent_step, indent_step + indent};
+        return {out, mode, indent_step, indent_step + indent};
     }
 };
 
-template <typename Value>
-void PrintValue(const Value& value, const PrintContext& ctx) {
-    ctx.out << value;
-}
-
+void PrintValue(int value, const PrintContext& ctx);
+void PrintValue(double value, const PrintContext& ctx);
+void PrintValue(bool value, const PrintContext& ctx);
 // Перегрузка функции PrintValue для вывода значений null
-void PrintValue(const bool& value, const PrintContext& ctx);
 void PrintValue(std::nullptr_t, const PrintContext& ctx);
 
+void PrintValue(std::string_view value, const PrintContext& ctx);
 void PrintValue(const std::string& value, const PrintContext& ctx);
 
 void PrintValue(const Array& arr, const PrintContext& ctx);
@@ -149,8 +293,55 @@ void PrintValue(const Node& dict, const PrintContext& ctx);
 
 void PrintNode(const Node& node, const PrintContext& ctx);
 
+/*
+ * Потоковый вывод JSON в буфер без построения Document, в том же формате, что и Print.
+ * Ключи словаря передаются в порядке возрастания, как их выводит Dict.
+ * Вложенность контейнеров ограничена 64 уровнями
+ */
+class Writer {
+public:
+    explicit Writer(std::string& out, PrintMode mode = PrintMode::Pretty);
+
+    Writer& StartArray();
+    Writer& EndArray();
+    Writer& StartDict();
+    Writer& EndDict();
+    Writer& Key(std::string_view key);
+
+    Writer& Value(int value);
+    Writer& Value(double value);
+    Writer& Value(bool value);
+    Writer& Value(std::nullptr_t);
+    Writer& Value(std::string_view value);
+    // Без этой перегрузки строковые литералы выводились бы как bool
+    Writer& Value(const char* value);
+    Writer& Value(const Node& value);
+
+    // Вывод очередных элементов открытого контейнера в отдельный буфер.
+    // Так части одного массива можно сформировать независимо и затем дописать их по порядку через Append.
+    // continues: в контейнере уже будут элементы перед выводом этой части
+    Writer Fork(std::string& out, bool continues) const;
+    // Дописывает часть контейнера, сформированную Writer из Fork
+    Writer& Append(std::string_view part);
+
+private:
+    PrintContext GetContext() const;
+    // Разделитель и отступ перед очередным элементом контейнера
+    void BeforeValue();
+    void Open(char bracket);
+    void Close(char bracket);
+
+    std::string& out_;
+    PrintMode mode_;
+    int depth_ = 0;
+    // Бит уровня вложенности установлен, если в контейнере уже есть элементы
+    uint64_t has_items_ = 0;
+    bool after_key_ = false;
+};
 
-void Print(const Document& doc, std::ostream& output);
+// Дописывает документ в конец буфера
+void Print(const Document& doc, std::string& buffer, PrintMode mode = PrintMode::Pretty);
+void Print(const Document& doc, std::ostream& output, PrintMode mode = PrintMode::Pretty);
 
 
 }// namespace json
@@ -0,0 +1,238 @@
+#pragma once
+
+#include "json.h"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Чтение структур напрямую из JSON по описанию их полей.
+ * Структура перечисляет поля в статическом кортеже kFields (см. Field в domain.h),
+ * а по нему во время компиляции строится таблица: идеальный хеш ключа -> функция чтения поля.
+ * Стоимость сопоставления ключа не зависит от количества полей,
+ * промежуточный Dict не строится. Прочитанные поля отмечаются в битовой маске,
+ * по ней после словаря проверяется, что все обязательные поля заданы
+ */
+
+namespace json::binding {
+
+// Чтение значения типа T. Специализации для нестандартных представлений
+// (перечислений, словарей в виде массивов и т.п.) объявляются рядом с местом использования
+template <typename T, typename = void>
+struct Decoder;
+
+template <typename T>
+void Decode(Reader& reader, T& value) {
+    Decoder<T>::Decode(reader, value);
+}
+
+template <>
+struct Decoder<int> {
+    static void Decode(Reader& reader, int& value) {
+        value = reader.ReadInt();
+    }
+};
+
+template <>
+struct Decoder<double> {
+    static void Decode(Reader& reader, double& value) {
+        value = reader.ReadDouble();
+    }
+};
+
+template <>
+struct Decoder<bool> {
+    static void Decode(Reader& reader, bool& value) {
+        value = reader.ReadBool();
+    }
+};
+
+template <>
+struct Decoder<std::string> {
+    static void Decode(Reader& reader, std::string& value) {
+        value = reader.ReadString();
+    }
+};
+
+template <typename T>
+struct Decoder<std::vector<T>> {
+    static void Decode(Reader& reader, std::vector<T>& values) {
+        // Повторный ключ заменяет массив, а не дополняет его
+        values.clear();
+        reader.StartArray();
+        while (reader.NextElement()) {
+            binding::Decode(reader, values.emplace_back());
+        }
+    }
+};
+
+// Необязательное поле остаётся пустым, если его ключа нет в словаре
+template <typename T>
+struct Decoder<std::optional<T>> {
+    static void Decode(Reader& reader, std::optional<T>& value) {
+        binding::Decode(reader, value.emplace());
+    }
+};
+
+namespace detail {
+
+constexpr uint32_t HashKey(std::string_view key, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ seed;
+    for (const char c : key) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return hash;
+}
+
+constexpr uint8_t kNoField = 0xff;
+constexpr size_t kFieldSlots = 64;
+
+// Таблица ячеек идеального хеша: номер поля или kNoField
+struct FieldLayout {
+    uint32_t seed = 0;
+    std::array<uint8_t, kFieldSlots> slots {};
+};
+
+// Подбирает затравку хеша, при которой ключи полей попадают в разные ячейки
+template <size_t N>
+constexpr FieldLayout MakeFieldLayout(const std::array<std::string_view, N>& keys) {
+    static_assert(N > 0 && N < kFieldSlots / 2, "unsupported number of fields");
+    for (uint32_t seed = 0; seed < 1024; ++seed) {
+        FieldLayout layout;
+        layout.seed = seed;
+        for (auto& slot : layout.slots) {
+            slot = kNoField;
+        }
+        bool collision = false;
+        for (size_t i = 0; i < N && !collision; ++i) {
+            auto& slot = layout.slots[HashKey(keys[i], seed) & (kFieldSlots - 1)];
+            collision = slot != kNoField;
+            slot = static_cast<uint8_t>(i);
+        }
+        if (!collision) {
+            return layout;
+        }
+    }
+    throw "no perfect hash for field keys";
+}
+
+template <typename T>
+constexpr size_t kFieldCount = std::tuple_size_v<std::remove_cv_t<decltype(T::kFields)>>;
+
+template <typename T>
+using FieldDecoder = void (*)(Reader&, T&);
+
+template <typename T, size_t I>
+void DecodeFieldAt(Reader& reader, T& value) {
+    constexpr const auto& field = std::get<I>(T::kFields);
+    Decoder<typename std::remove_cv_t<std::remove_reference_t<decltype(field)>>::Type>::Decode(reader, field.Get(value));
+}
+
+template <typename T, size_t... Is>
+constexpr std::array<std::string_view, sizeof...(Is)> MakeFieldKeys(std::index_sequence<Is...>) {
+    return {std::get<Is>(T::kFields).key...};
+}
+
+template <typename T, size_t... Is>
+constexpr std::array<FieldDecoder<T>, sizeof...(Is)> MakeFieldDecoders(std::index_sequence<Is...>) {
+    return {&DecodeFieldAt<T, Is>...};
+}
+
+template <typename T>
+constexpr auto kFieldKeys = MakeFieldKeys<T>(std::make_index_sequence<kFieldCount<T>>{});
+
+template <typename T>
+constexpr auto kFieldDecoders = MakeFieldDecoders<T>(std::make_index_sequence<kFieldCount<T>>{});
+
+template <typename T>
+constexpr FieldLayout kFieldLayout = MakeFieldLayout(kFieldKeys<T>);
+
+// Маска обязательных полей: бит i соответствует i-му полю kFields
+template <typename T, size_t... Is>
+constexpr uint64_t MakeRequiredMask(std::index_sequence<Is...>) {
+    return ((std::get<Is>(T::kFields).IsRequired() ? uint64_t{1} << Is : 0) | ...);
+}
+
+template <typename T>
+constexpr uint64_t kRequiredFields = MakeRequiredMask<T>(std::make_index_sequence<kFieldCount<T>>{});
+
+// Читает значение поля с ключом key. Возвращает номер поля или kNoField, если такого поля нет
+template <typename T>
+uint8_t DecodeField(std::string_view key, Reader& reader, T& value) {
+    constexpr const FieldLayout& layout = kFieldLayout<T>;
+    const uint8_t index = layout.slots[HashKey(key, layout.seed) & (kFieldSlots - 1)];
+    if (index == kNoField || kFieldKeys<T>[index] != key) {
+        return kNoField;
+    }
+    kFieldDecoders<T>[index](reader, value);
+    return index;
+}
+
+template <typename T, typename Handler>
+void DecodeAs(Reader& reader, Handler& handler) {
+    T value;
+    Decoder<T>::Decode(reader, value);
+    handler(std::move(value));
+}
+
+}  // namespace detail
+
+// Структуры с описанием полей читаются из словаря, неизвестные ключи пропускаются.
+// Если нет обязательного поля, бросает ParsingError с его ключом
+template <typename T>
+struct Decoder<T, std::void_t<decltype(T::kFields)>> {
+    static void Decode(Reader& reader, T& value) {
+        reader.StartObject();
+        std::string_view key;
+        uint64_t seen = 0;
+        while (reader.NextKey(key)) {
+            const uint8_t index = detail::DecodeField(key, reader, value);
+            if (index == detail::kNoField) {
+                reader.Skip();
+            } else {
+                seen |= uint64_t{1} << index;
+            }
+        }
+        const uint64_t missing = detail::kRequiredFields<T> & ~seen;
+        if (missing != 0) {
+            const std::string_view missing_key = detail::kFieldKeys<T>[std::countr_zero(missing)];
+            throw ParsingError(std::string("missing field \"").append(missing_key).append("\""));
+        }
+    }
+};
+
+/*
+ * Читает словарь, вид которого задаётся строковым полем tag_key.
+ * Вид сравнивается с константами Types::kType, словарь читается в подходящую структуру,
+ * которая передаётся в handler. Словари неизвестного вида пропускаются.
+ * Поле вида может стоять в любом месте словаря: сначала оно ищется копией Reader
+ */
+template <typename... Types, typename Handler>
+void DecodeTagged(Reader& reader, std::string_view tag_key, Handler&& handler) {
+    Reader probe = reader;
+    probe.StartObject();
+    std::string_view key;
+    std::string_view tag;
+    while (probe.NextKey(key)) {
+        if (key == tag_key) {
+            tag = probe.ReadString();
+            break;
+        }
+        probe.Skip();
+    }
+
+    const bool decoded = ((tag == Types::kType && (detail::DecodeAs<Types>(reader, handler), true)) || ...);
+    if (!decoded) {
+        reader.Skip();
+    }
+}
+
+}  // namespace json::binding
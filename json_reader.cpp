@@ -1,122 +1,617 @@
 #include "json_reader.h"
 #include "json.h"
+#include "json_binding.h"
+#include "thread_pool.h"
+#include "transport_router.h"
+#include "map_renderer.h"
 
 #include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 
 /*
  * Здесь можно разместить код наполнения транспортного справочника данными из JSON,
  * а также код обработки запросов к базе и формирование массива ответов в формате JSON
  */
 using namespace json;
+using namespace std::literals;
 
-json::Document JsonReader::ApplyCommands([[maybe_unused]] transport::TransportCatalogue& catalogue) const {
-    for (const auto& cmd : commands_.stop_requests) {
-        catalogue.AddStop(cmd.name, cmd.place);        
+namespace json::binding {
+
+template <>
+struct Decoder<StatType> {
+    static void Decode(Reader& reader, StatType& type) {
+        const auto name = reader.ReadString();
+        if (name == "Bus"sv) {
+            type = StatType::Bus;
+        } else if (name == "Stop"sv) {
+            type = StatType::Stop;
+        } else if (name == "Route"sv) {
+            type = StatType::Route;
+        } else if (name == "NearestStops"sv) {
+            type = StatType::NearestStops;
+        } else if (name == "StopsInRadius"sv) {
+            type = StatType::StopsInRadius;
+        } else if (name == "StopsInBox"sv) {
+            type = StatType::StopsInBox;
+        } else if (name == "Map"sv) {
+            type = StatType::Map;
+        } else {
+            throw ParsingError("Unknown stat request type "s + std::string(name));
+        }
     }
-    for (const auto& cmd : commands_.stop_requests) {
-        for (const auto& to : cmd.road_distances) {
-            catalogue.AddDistance(cmd.name, to.stop, to.distance);
-        }       
+};
+
+// Расстояния до соседних остановок записаны словарём "название": расстояние
+template <>
+struct Decoder<std::vector<StopDistance>> {
+    static void Decode(Reader& reader, std::vector<StopDistance>& distances) {
+        distances.clear();
+        reader.StartObject();
+        std::string_view stop;
+        while (reader.NextKey(stop)) {
+            auto& distance = distances.emplace_back();
+            distance.stop = stop;
+            distance.distance = reader.ReadInt();
+        }
     }
-    for (const auto& cmd : commands_.bus_requests) {
-        catalogue.AddBus(cmd.name, cmd.stops);        
+};
+
+// Смещение записано массивом [dx, dy]
+template <>
+struct Decoder<svg::Point> {
+    static void Decode(Reader& reader, svg::Point& point) {
+        reader.StartArray();
+        if (!reader.NextElement()) {
+            throw ParsingError("Point must have two coordinates"s);
+        }
+        point.x = reader.ReadDouble();
+        if (!reader.NextElement()) {
+            throw ParsingError("Point must have two coordinates"s);
+        }
+        point.y = reader.ReadDouble();
+        if (reader.NextElement()) {
+            throw ParsingError("Point must have two coordinates"s);
+        }
     }
-    Array ans;
-    for (const auto& cmd : commands_.stat_requests) {
-        json::Dict result;
-        switch (cmd.type) {
-            case StatType::Bus: {
-                const auto bus = catalogue.GetBus(cmd.name);
-                const auto stat = catalogue.GetStat(bus);
-                result["request_id"] = cmd.id;
-                if (!stat) {
-                    result["error_message"] = "not found";
-                } else {
-                    result["curvature"] = stat->curvature;
-                    result["route_length"] = stat->dist;
-                    result["stop_count"] = static_cast<int>(stat->stops_count);
-                    result["unique_stop_count"] = static_cast<int>(stat->unique_stops);
-                }
-                break;
+};
+
+template <>
+struct Decoder<renderer::RenderColor> {
+    static void Decode(Reader& reader, renderer::RenderColor& color) {
+        if (reader.Peek() == '"') {
+            color.value = reader.ReadString();
+            return;
+        }
+        int rgb[3];
+        reader.StartArray();
+        for (int& component : rgb) {
+            if (!reader.NextElement()) {
+                throw ParsingError("Color must have three or four components"s);
             }
-            case StatType::Stop: {
-                const auto buses4stop = catalogue.GetBusses4Stop(cmd.name);
-                result["request_id"] = cmd.id;
-                if (!buses4stop) {
-                    result["error_message"] = "not found";
-                } else {
-                    Array buses;
-                    for (const auto& bus : *buses4stop) {
-                        buses.push_back(std::string(bus));
-                    }
-                    result["buses"] = buses;
-                }
-                break;
+            component = reader.ReadInt();
+        }
+        std::ostringstream out;
+        if (!reader.NextElement()) {
+            out << "rgb(" << rgb[0] << ',' << rgb[1] << ',' << rgb[2] << ')';
+        } else {
+            out << "rgba(" << rgb[0] << ',' << rgb[1] << ',' << rgb[2] << ',' << reader.ReadDouble() << ')';
+            if (reader.NextElement()) {
+                throw ParsingError("Color must have three or four components"s);
             }
         }
-        ans.push_back(result);
+        color.value = std::move(out).str();
     }
-    return Document(ans);
+};
+
 }
 
-void JsonReader::ParseCommands(std::istream& in) {
-    Document doc = json::Load(in);
-    const auto& root = doc.GetRoot().AsMap();
-    
-    for (auto ptr = root.find("base_requests"); ptr != root.end(); ptr = root.end()) {
-        const auto& requests = ptr->second.AsArray();
-        for (const auto& r : requests) {
-            const auto& base_request = r.AsMap();
-            std::string type = base_request.at("type").AsString();
-            std::string name = base_request.at("name").AsString();
-            if (type == "Stop") {
-                StopRequest ans;
-                ans.name = name;
-                ans.place = {base_request.at("latitude").AsDouble(), base_request.at("longitude").AsDouble()};
-                if (base_request.count("road_distances")) {
-                    for (const auto& [id, dist] : base_request.at("road_distances").AsMap()) {
-                        ans.road_distances.push_back({id, dist.AsInt()});
-                    }
-                }
-                commands_.stop_requests.push_back(ans);
-            } else if (type == "Bus") {
-                BusRequest ans;
-                ans.name = name;
-                const auto& stops = base_request.at("stops").AsArray();          
-                for (const auto& stop : stops) {
-                    ans.stops.push_back(commands_.AddId(stop.AsString()));
+namespace {
+
+// Возвращает полный маршрут автобуса: некольцевой дополняется обратным направлением
+std::vector<std::string_view> MakeRoute(const BusRequest& bus) {
+    std::vector<std::string_view> route(bus.stops.begin(), bus.stops.end());
+    if (!bus.is_roundtrip && !route.empty()) {
+        route.reserve(2 * route.size() - 1);
+        for (size_t i = bus.stops.size() - 1; i > 0; --i) {
+            route.push_back(bus.stops[i - 1]);
+        }
+    }
+    return route;
+}
+
+void WriteJourney(const transport::Journey& journey, json::Writer& writer) {
+    writer.Key("items"sv).StartArray();
+    for (const auto& item : journey.items) {
+        writer.StartDict();
+        if (const auto* wait = std::get_if<transport::WaitItem>(&item)) {
+            writer.Key("stop_name"sv).Value(wait->stop);
+            writer.Key("time"sv).Value(wait->time);
+            writer.Key("type"sv).Value("Wait"sv);
+        } else {
+            const auto& ride = std::get<transport::RideItem>(item);
+            writer.Key("bus"sv).Value(ride.bus);
+            writer.Key("span_count"sv).Value(ride.span_count);
+            writer.Key("time"sv).Value(ride.time);
+            writer.Key("type"sv).Value("Bus"sv);
+        }
+        writer.EndDict();
+    }
+    writer.EndArray();
+}
+
+template <typename Catalogue>
+void WriteNearbyStops(const std::vector<transport::NearbyStop>& stops, const Catalogue& catalogue, json::Writer& writer) {
+    writer.Key("stops"sv).StartArray();
+    for (const auto& stop : stops) {
+        writer.StartDict();
+        writer.Key("distance"sv).Value(stop.distance);
+        writer.Key("name"sv).Value(catalogue.GetStopName(stop.stop));
+        writer.EndDict();
+    }
+    writer.EndArray();
+}
+
+// Справочник и его двоичный снимок предоставляют одинаковые методы для запросов к базе.
+// Без маршрутизатора запросы Route, без визуализатора запросы Map получают ошибку.
+// Ключи ответов выводятся в алфавитном порядке
+template <typename Catalogue>
+void WriteAnswer(const StatRequest& cmd, const Catalogue& catalogue, const transport::TransportRouter* router,
+                 const renderer::MapRenderer* renderer, json::Writer& writer) {
+    writer.StartDict();
+    switch (cmd.type) {
+        case StatType::Bus: {
+            const auto bus = catalogue.GetBus(cmd.name);
+            const auto stat = catalogue.GetStat(bus);
+            if (!stat) {
+                writer.Key("error_message"sv).Value("not found"sv);
+                writer.Key("request_id"sv).Value(cmd.id);
+            } else {
+                writer.Key("curvature"sv).Value(stat->curvature);
+                writer.Key("request_id"sv).Value(cmd.id);
+                writer.Key("route_length"sv).Value(stat->dist);
+                writer.Key("stop_count"sv).Value(static_cast<int>(stat->stops_count));
+                writer.Key("unique_stop_count"sv).Value(static_cast<int>(stat->unique_stops));
+            }
+            break;
+        }
+        case StatType::Stop: {
+            const auto buses4stop = catalogue.GetBusses4Stop(cmd.name);
+            if (!buses4stop) {
+                writer.Key("error_message"sv).Value("not found"sv);
+                writer.Key("request_id"sv).Value(cmd.id);
+            } else {
+                writer.Key("buses"sv).StartArray();
+                for (const auto bus : *buses4stop) {
+                    writer.Value(std::string_view(bus));
                 }
-                ans.is_roundtrip = base_request.at("is_roundtrip").AsBool();
-                if (!ans.is_roundtrip) {
-                    std::vector<std::string_view> return_stops;
-                    for (auto it = ans.stops.rbegin(); it != ans.stops.rend();++it) {
-                        if (it == ans.stops.rbegin()) {
-                            continue;
-                        }
-                        return_stops.push_back(*it);
+                writer.EndArray();
+                writer.Key("request_id"sv).Value(cmd.id);
+            }
+            break;
+        }
+        case StatType::Route: {
+            if (!router) {
+                writer.Key("error_message"sv).Value("routing is not available"sv);
+                writer.Key("request_id"sv).Value(cmd.id);
+                break;
+            }
+            const auto journey = router->FindRoute(cmd.from, cmd.to);
+            if (!journey) {
+                writer.Key("error_message"sv).Value("not found"sv);
+                writer.Key("request_id"sv).Value(cmd.id);
+            } else {
+                WriteJourney(*journey, writer);
+                writer.Key("request_id"sv).Value(cmd.id);
+                writer.Key("total_time"sv).Value(journey->total_time);
+            }
+            break;
+        }
+        case StatType::NearestStops: {
+            const auto count = static_cast<size_t>(std::max(cmd.count, 0));
+            writer.Key("request_id"sv).Value(cmd.id);
+            WriteNearbyStops(catalogue.GetStopIndex().FindNearest(cmd.place, count), catalogue, writer);
+            break;
+        }
+        case StatType::StopsInRadius: {
+            writer.Key("request_id"sv).Value(cmd.id);
+            WriteNearbyStops(catalogue.GetStopIndex().FindInRadius(cmd.place, cmd.radius), catalogue, writer);
+            break;
+        }
+        case StatType::StopsInBox: {
+            writer.Key("request_id"sv).Value(cmd.id);
+            // Номера остановок упорядочены так же, как названия
+            writer.Key("stops"sv).StartArray();
+            for (const auto stop : catalogue.GetStopIndex().FindInBox(cmd.min_place, cmd.max_place)) {
+                writer.Value(catalogue.GetStopName(stop));
+            }
+            writer.EndArray();
+            break;
+        }
+        case StatType::Map: {
+            // Визуализатор рисует по справочнику, запросы Map к снимку отклоняются до ответа
+            if constexpr (std::is_same_v<Catalogue, transport::FrozenCatalogue>) {
+                if (renderer) {
+                    std::string map;
+                    bool found = true;
+                    if (cmd.tile) {
+                        found = renderer->RenderTile(catalogue, *cmd.tile, map);
+                    } else if (cmd.bbox) {
+                        found = renderer->RenderBox(catalogue, *cmd.bbox, map);
+                    } else {
+                        renderer->RenderMap(catalogue, map);
                     }
-                    for (const auto& s : return_stops) {
-                        ans.stops.push_back(s);
+                    if (found) {
+                        writer.Key("map"sv).Value(std::string_view(map));
+                    } else {
+                        writer.Key("error_message"sv).Value("not found"sv);
                     }
+                    writer.Key("request_id"sv).Value(cmd.id);
+                    break;
                 }
-                commands_.bus_requests.push_back(ans);
             }
+            writer.Key("error_message"sv).Value("map is not available"sv);
+            writer.Key("request_id"sv).Value(cmd.id);
+            break;
         }
     }
-    for (auto ptr = root.find("stat_requests"); ptr != root.end(); ptr = root.end()) {
-        const auto& requests = ptr->second.AsArray();
-        for (const auto& req : requests) {
-            StatRequest ans;
-            const auto& r = req.AsMap();
-            ans.id = r.at("id").AsInt();
-            std::string type = r.at("type").AsString();
-            if (type == "Bus") {
-                ans.type = StatType::Bus;
-            } else if (type == "Stop") {
-                ans.type = StatType::Stop;
+    writer.EndDict();
+}
+
+constexpr size_t kAnswerChunkSize = 256;
+
+/*
+ * Без пула ответы выводятся по порядку. С пулом запросы делятся на куски по kAnswerChunkSize,
+ * ответы каждого куска форматируются в свой буфер, и буферы дописываются в порядке запросов,
+ * поэтому вывод совпадает с последовательным
+ */
+template <typename Catalogue>
+void AnswerStatRequests(const std::vector<StatRequest>& requests, const Catalogue& catalogue,
+                        const transport::TransportRouter* router, const renderer::MapRenderer* renderer,
+                        ThreadPool* pool, json::Writer& writer) {
+    writer.StartArray();
+    if (!pool || requests.size() <= kAnswerChunkSize) {
+        for (const auto& cmd : requests) {
+            WriteAnswer(cmd, catalogue, router, renderer, writer);
+        }
+    } else {
+        std::vector<std::string> parts((requests.size() + kAnswerChunkSize - 1) / kAnswerChunkSize);
+        pool->ParallelFor(parts.size(), [&](size_t index) {
+            json::Writer part = writer.Fork(parts[index], index > 0);
+            const size_t begin = index * kAnswerChunkSize;
+            const size_t end = std::min(begin + kAnswerChunkSize, requests.size());
+            for (size_t i = begin; i < end; ++i) {
+                WriteAnswer(requests[i], catalogue, router, renderer, part);
             }
-            ans.name = r.at("name").AsString();
-            commands_.stat_requests.push_back(ans);
+        });
+        for (const auto& part : parts) {
+            writer.Append(part);
+        }
+    }
+    writer.EndArray();
+}
+
+// Находит границы элементов массива, не разбирая их содержимое
+std::vector<std::string_view> SplitArray(json::Reader& reader) {
+    std::vector<std::string_view> elements;
+    reader.StartArray();
+    while (reader.NextElement()) {
+        elements.push_back(reader.SkipRaw());
+    }
+    return elements;
+}
+
+constexpr size_t kParseChunkSize = 512;
+
+// Разбирает элементы массива кусками по kParseChunkSize в нескольких потоках.
+// Каждый кусок заполняет свой результат, порядок кусков совпадает с порядком элементов
+template <typename Chunk, typename DecodeElement>
+std::vector<Chunk> DecodeInChunks(const std::vector<std::string_view>& elements, ThreadPool& pool,
+                                  DecodeElement decode) {
+    std::vector<Chunk> chunks((elements.size() + kParseChunkSize - 1) / kParseChunkSize);
+    pool.ParallelFor(chunks.size(), [&](size_t index) {
+        const size_t begin = index * kParseChunkSize;
+        const size_t end = std::min(begin + kParseChunkSize, elements.size());
+        for (size_t i = begin; i < end; ++i) {
+            json::Reader reader(elements[i]);
+            decode(reader, chunks[index]);
         }
+    });
+    return chunks;
+}
+
+template <typename T>
+void AppendChunks(std::vector<T>& to, std::vector<std::vector<T>>& chunks) {
+    size_t total = to.size();
+    for (const auto& chunk : chunks) {
+        total += chunk.size();
+    }
+    to.reserve(total);
+    for (auto& chunk : chunks) {
+        std::move(chunk.begin(), chunk.end(), std::back_inserter(to));
     }
 }
+
+void AppendChunks(Commands& to, std::vector<Commands>& chunks) {
+    std::vector<std::vector<StopRequest>> stop_chunks;
+    std::vector<std::vector<BusRequest>> bus_chunks;
+    for (auto& chunk : chunks) {
+        stop_chunks.push_back(std::move(chunk.stop_requests));
+        bus_chunks.push_back(std::move(chunk.bus_requests));
+    }
+    AppendChunks(to.stop_requests, stop_chunks);
+    AppendChunks(to.bus_requests, bus_chunks);
+}
+
+void DecodeBaseRequest(json::Reader& reader, Commands& chunk) {
+    binding::DecodeTagged<StopRequest, BusRequest>(reader, "type"sv, [&chunk](auto&& request) {
+        using Request = std::decay_t<decltype(request)>;
+        if constexpr (std::is_same_v<Request, StopRequest>) {
+            chunk.stop_requests.push_back(std::move(request));
+        } else {
+            chunk.bus_requests.push_back(std::move(request));
+        }
+    });
+}
+
+void DecodeStatRequest(json::Reader& reader, std::vector<StatRequest>& chunk) {
+    binding::Decode(reader, chunk.emplace_back());
+}
+
+constexpr size_t kStreamBatchSize = 16 * kParseChunkSize;
+
+/*
+ * Разбирает элементы массива по мере чтения из потока и дописывает их в to.
+ * Без пула каждый элемент разбирается сразу после чтения. С пулом тексты элементов
+ * копируются пакетами по kStreamBatchSize и разбираются через DecodeInChunks,
+ * так что в памяти держится только текущий пакет, а не весь документ
+ */
+template <typename Chunk, typename DecodeElement>
+void DecodeStream(json::StreamReader& reader, ThreadPool* pool, Chunk& to, DecodeElement decode) {
+    reader.StartArray();
+    if (!pool) {
+        while (reader.NextElement()) {
+            json::Reader element(reader.ReadRaw());
+            decode(element, to);
+        }
+        return;
+    }
+    std::string batch;
+    std::vector<size_t> ends;
+    auto flush = [&]() {
+        std::vector<std::string_view> elements;
+        elements.reserve(ends.size());
+        size_t begin = 0;
+        for (const size_t end : ends) {
+            elements.push_back(std::string_view(batch).substr(begin, end - begin));
+            begin = end;
+        }
+        auto chunks = DecodeInChunks<Chunk>(elements, *pool, decode);
+        AppendChunks(to, chunks);
+        batch.clear();
+        ends.clear();
+    };
+    while (reader.NextElement()) {
+        batch += reader.ReadRaw();
+        ends.push_back(batch.size());
+        if (ends.size() == kStreamBatchSize) {
+            flush();
+        }
+    }
+    if (!ends.empty()) {
+        flush();
+    }
+}
+
+// Разбирает значение из потока целиком: настройки занимают немного места
+template <typename T>
+void DecodeValue(json::StreamReader& reader, T& value) {
+    json::Reader element(reader.ReadRaw());
+    binding::Decode(element, value);
+}
+
+}
+
+JsonReader::JsonReader() = default;
+
+JsonReader::JsonReader(size_t threads) {
+    if (threads > 1) {
+        pool_ = std::make_unique<ThreadPool>(threads);
+    }
+}
+
+JsonReader::~JsonReader() = default;
+
+transport::FrozenCatalogue JsonReader::ApplyCommands(transport::CatalogueBuilder& catalogue, json::Writer& writer) const {
+    ApplyBaseRequests(catalogue);
+    auto frozen = catalogue.Freeze();
+    AnswerStatRequests(frozen, writer);
+    return frozen;
+}
+
+void JsonReader::ApplyBaseRequests(transport::CatalogueBuilder& catalogue) const {
+    catalogue.Apply(MakeDelta());
+}
+
+transport::CatalogueDelta JsonReader::MakeDelta() const {
+    transport::CatalogueDelta delta;
+    delta.stops.reserve(commands_.stop_requests.size());
+    for (const auto& cmd : commands_.stop_requests) {
+        delta.stops.push_back({cmd.name, cmd.place});
+        for (const auto& to : cmd.road_distances) {
+            delta.distances.push_back({cmd.name, to.stop, to.distance});
+        }
+    }
+    delta.buses.reserve(commands_.bus_requests.size());
+    for (const auto& cmd : commands_.bus_requests) {
+        delta.buses.push_back({cmd.name, MakeRoute(cmd), cmd.is_roundtrip});
+    }
+    return delta;
+}
+
+bool JsonReader::HasBaseRequests() const {
+    return !commands_.stop_requests.empty() || !commands_.bus_requests.empty();
+}
+
+bool JsonReader::HasRouteRequests() const {
+    return std::any_of(commands_.stat_requests.begin(), commands_.stat_requests.end(), [](const StatRequest& cmd) {
+        return cmd.type == StatType::Route;
+    });
+}
+
+const std::optional<RoutingSettings>& JsonReader::GetRoutingSettings() const {
+    return commands_.routing_settings;
+}
+
+const std::optional<renderer::RenderSettings>& JsonReader::GetRenderSettings() const {
+    return render_settings_;
+}
+
+void JsonReader::AnswerStatRequests(const transport::FrozenCatalogue& catalogue, json::Writer& writer) const {
+    // Граф строится, только если он нужен для ответов
+    std::optional<transport::TransportRouter> router;
+    if (commands_.routing_settings && HasRouteRequests()) {
+        router.emplace(catalogue, *commands_.routing_settings);
+    }
+    std::optional<renderer::MapRenderer> renderer;
+    if (render_settings_) {
+        renderer.emplace(*render_settings_);
+    }
+    AnswerStatRequests(catalogue, router ? &*router : nullptr, renderer ? &*renderer : nullptr, writer);
+}
+
+void JsonReader::AnswerStatRequests(const transport::FrozenCatalogue& catalogue,
+                                    const transport::TransportRouter* router, const renderer::MapRenderer* renderer,
+                                    json::Writer& writer) const {
+    ::AnswerStatRequests(commands_.stat_requests, catalogue, router, renderer, pool_.get(), writer);
+}
+
+void JsonReader::AnswerStatRequests(const transport::CatalogueSnapshot& snapshot, json::Writer& writer) const {
+    for (const auto& cmd : commands_.stat_requests) {
+        if (cmd.type == StatType::Route || cmd.type == StatType::Map) {
+            throw std::invalid_argument("request " + std::to_string(cmd.id)
+                                        + ": Route and Map requests cannot be answered from a snapshot");
+        }
+    }
+    ::AnswerStatRequests(commands_.stat_requests, snapshot, nullptr, nullptr, pool_.get(), writer);
+}
+
+void JsonReader::ParseCommands(std::istream& in) {
+    json::StreamReader reader(in);
+    reader.StartObject();
+    std::string key;
+    while (reader.NextKey(key)) {
+        if (key == "base_requests"sv) {
+            DecodeStream(reader, pool_.get(), commands_, DecodeBaseRequest);
+        } else if (key == "stat_requests"sv) {
+            DecodeStream(reader, pool_.get(), commands_.stat_requests, DecodeStatRequest);
+        } else if (key == "routing_settings"sv) {
+            DecodeValue(reader, commands_.routing_settings.emplace());
+        } else if (key == "render_settings"sv) {
+            DecodeValue(reader, render_settings_.emplace());
+        } else {
+            reader.Skip();
+        }
+    }
+}
+
+void JsonReader::ParseCommands(std::string_view input) {
+    if (pool_) {
+        ParseCommandsParallel(input);
+        return;
+    }
+    json::Reader reader(input);
+    reader.StartObject();
+    std::string_view key;
+    while (reader.NextKey(key)) {
+        if (key == "base_requests"sv) {
+            reader.StartArray();
+            while (reader.NextElement()) {
+                binding::DecodeTagged<StopRequest, BusRequest>(reader, "type"sv, [this](auto&& request) {
+                    AddRequest(std::move(request));
+                });
+            }
+        } else if (key == "stat_requests"sv) {
+            binding::Decode(reader, commands_.stat_requests);
+        } else if (key == "routing_settings"sv) {
+            binding::Decode(reader, commands_.routing_settings.emplace());
+        } else if (key == "render_settings"sv) {
+            binding::Decode(reader, render_settings_.emplace());
+        } else {
+            reader.Skip();
+        }
+    }
+}
+
+/*
+ * Параллельный разбор в два прохода. Сначала один поток находит границы элементов
+ * массивов base_requests и stat_requests, затем элементы разбираются кусками в пуле потоков.
+ * Куски объединяются в исходном порядке, поэтому результат совпадает с последовательным разбором
+ */
+void JsonReader::ParseCommandsParallel(std::string_view input) {
+    std::vector<std::string_view> base_elements;
+    std::vector<std::string_view> stat_elements;
+    json::Reader reader(input);
+    reader.StartObject();
+    std::string_view key;
+    while (reader.NextKey(key)) {
+        if (key == "base_requests"sv) {
+            auto elements = SplitArray(reader);
+            base_elements.insert(base_elements.end(), elements.begin(), elements.end());
+        } else if (key == "stat_requests"sv) {
+            auto elements = SplitArray(reader);
+            stat_elements.insert(stat_elements.end(), elements.begin(), elements.end());
+        } else if (key == "routing_settings"sv) {
+            binding::Decode(reader, commands_.routing_settings.emplace());
+        } else if (key == "render_settings"sv) {
+            binding::Decode(reader, render_settings_.emplace());
+        } else {
+            reader.Skip();
+        }
+    }
+
+    auto base_chunks = DecodeInChunks<Commands>(base_elements, *pool_, DecodeBaseRequest);
+    auto stat_chunks = DecodeInChunks<std::vector<StatRequest>>(stat_elements, *pool_, DecodeStatRequest);
+    AppendChunks(commands_, base_chunks);
+    AppendChunks(commands_.stat_requests, stat_chunks);
+}
+
+void JsonReader::ParseRequest(std::string_view input) {
+    // Отдельный запрос отличается от документа с запросами набором ключей верхнего уровня
+    json::Reader probe(input);
+    probe.StartObject();
+    bool is_document = false;
+    bool is_stat = false;
+    std::string_view key;
+    while (probe.NextKey(key)) {
+        if (key == "base_requests"sv || key == "stat_requests"sv || key == "routing_settings"sv
+            || key == "render_settings"sv) {
+            is_document = true;
+            break;
+        }
+        is_stat = is_stat || key == "id"sv;
+        probe.Skip();
+    }
+
+    json::Reader reader(input);
+    if (is_document) {
+        ParseCommands(input);
+    } else if (is_stat) {
+        binding::Decode(reader, commands_.stat_requests.emplace_back());
+    } else {
+        binding::DecodeTagged<StopRequest, BusRequest>(reader, "type"sv, [this](auto&& request) {
+            AddRequest(std::move(request));
+        });
+    }
+}
+
+void JsonReader::AddRequest(StopRequest&& request) {
+    commands_.stop_requests.push_back(std::move(request));
+}
+
+void JsonReader::AddRequest(BusRequest&& request) {
+    commands_.bus_requests.push_back(std::move(request));
+}
@@ -2,7 +2,17 @@
 
 #include "domain.h"
 #include "transport_catalogue.h"
+#include "catalogue_snapshot.h"
 #include "json.h"
+#include "map_renderer.h"
+#include "thread_pool.h"
+
+#include <memory>
+#include <optional>
+
+namespace transport {
+class TransportRouter;
+}
 
 /*
  * Здесь можно разместить код наполнения транспортного справочника данными из JSON,
@@ -11,11 +21,51 @@
 
 class JsonReader {
 public:
-    JsonReader() = default;
+    JsonReader();
+    // При threads > 1 большие массивы запросов разбираются, а запросы к базе выполняются
+    // в пуле из threads потоков. Результат совпадает с последовательной обработкой
+    explicit JsonReader(size_t threads);
+    ~JsonReader();
     
+    // Читает документ из потока по частям: в памяти одновременно держится только текст
+    // очередного запроса (или пакета запросов при разборе в пуле потоков), а не весь документ
     void ParseCommands(std::istream& in);
+    void ParseCommands(std::string_view input);
+    // Разбирает документ с запросами либо один запрос к базе или на её наполнение
+    void ParseRequest(std::string_view input);
     
-    json::Document ApplyCommands([[maybe_unused]] transport::TransportCatalogue& catalogue) const;
+    // Наполняет справочник, строит его неизменяемую версию и отвечает на запросы к ней
+    transport::FrozenCatalogue ApplyCommands(transport::CatalogueBuilder& catalogue, json::Writer& writer) const;
+    // Добавляет в справочник остановки, расстояния и маршруты.
+    // Уже известные остановки и маршруты заменяются новыми описаниями.
+    // Если расстояние или маршрут ссылается на неизвестную остановку, бросает out_of_range
+    // с её названием, и справочник не меняется
+    void ApplyBaseRequests(transport::CatalogueBuilder& catalogue) const;
+    // Запросы на наполнение базы как один набор изменений. Он ссылается на названия из запросов
+    transport::CatalogueDelta MakeDelta() const;
+    bool HasBaseRequests() const;
+    bool HasRouteRequests() const;
+    const std::optional<RoutingSettings>& GetRoutingSettings() const;
+    const std::optional<renderer::RenderSettings>& GetRenderSettings() const;
+    // Выводит массив ответов на запросы к базе, не строя промежуточный Document.
+    // При повторном использовании буфера вывода ответы не выделяют динамическую память.
+    // Маршрутизатор для запросов Route строится по routing_settings, визуализатор для запросов Map -
+    // по render_settings, если они заданы
+    void AnswerStatRequests(const transport::FrozenCatalogue& catalogue, json::Writer& writer) const;
+    // Отвечает на запросы Route готовым маршрутизатором, построенным по тому же справочнику,
+    // а на запросы Map - готовым визуализатором
+    void AnswerStatRequests(const transport::FrozenCatalogue& catalogue, const transport::TransportRouter* router,
+                            const renderer::MapRenderer* renderer, json::Writer& writer) const;
+    // В снимке нет расстояний между остановками и признака кольцевого маршрута, поэтому маршрутизатор
+    // и визуализатор по нему не построить. Если среди запросов есть Route или Map, бросает invalid_argument
+    // с номером такого запроса, ничего не выводя
+    void AnswerStatRequests(const transport::CatalogueSnapshot& snapshot, json::Writer& writer) const;
+private:
+    void AddRequest(StopRequest&& request);
+    void AddRequest(BusRequest&& request);
+    void ParseCommandsParallel(std::string_view input);
 private:
     Commands commands_;
+    std::optional<renderer::RenderSettings> render_settings_;
+    std::unique_ptr<ThreadPool> pool_;
 };
@@ -1,14 +1,147 @@
 #include "transport_catalogue.h"
 #include "json.h"
 #include "json_reader.h"
+#include "mapped_file.h"
+#include "catalogue_snapshot.h"
+#include "thread_pool.h"
+#include "versioned_catalogue.h"
+#include "transport_router.h"
+#include "map_renderer.h"
 
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
 
 using namespace std;
 using namespace transport;
 using namespace json;
 
-int main() {
+namespace {
+
+// Читает запросы из файла, если путь указан, иначе из stdin
+void ReadCommands(const string& input_path, JsonReader& reader) {
+    if (!input_path.empty()) {
+        const MappedFile input(input_path);
+        reader.ParseCommands(input.GetData());
+    } else {
+        reader.ParseCommands(cin);
+    }
+}
+
+// Заполняет справочник запросами и выводит ответы на запросы к нему.
+// Возвращает неизменяемую версию справочника, по которой даны ответы
+FrozenCatalogue ProcessDocument(const string& input_path, size_t threads, CatalogueBuilder& db, Writer& writer) {
+    JsonReader reader(threads);
+    ReadCommands(input_path, reader);
+    return reader.ApplyCommands(db, writer);
+}
+
+/*
+ * Режим JSON Lines: справочник строится один раз (из файла, если он указан),
+ * затем каждая строка stdin содержит документ с запросами или один запрос.
+ * На каждую строку в stdout выводится одна строка с массивом ответов на запросы к базе.
+ * Запросы на наполнение базы дополняют и обновляют уже построенный справочник
+ * и публикуют его новую версию, запросы к базе выполняются к текущей версии.
+ * Последние заданные routing_settings и render_settings действуют для всех следующих строк.
+ * Вывод сбрасывается, когда во входном буфере не осталось готовых строк
+ */
+void RunJsonLines(const string& input_path, size_t threads) {
+    VersionedCatalogue catalogue;
+    // Буфер вывода переиспользуется между строками
+    string output;
+    optional<RoutingSettings> settings;
+    // Маршрутизатор перестраивается только для новой версии справочника или новых настроек.
+    // Он ссылается на версию, поэтому она удерживается вместе с ним
+    VersionedCatalogue::Version router_version;
+    unique_ptr<TransportRouter> router;
+    optional<renderer::MapRenderer> renderer;
+    auto answer = [&](const JsonReader& reader) {
+        const auto version = reader.HasBaseRequests()
+            ? catalogue.Update(reader.MakeDelta())
+            : catalogue.Acquire();
+        if (reader.GetRoutingSettings()) {
+            settings = reader.GetRoutingSettings();
+        }
+        if (settings && reader.HasRouteRequests()
+            && (!router || router_version != version || router->GetSettings() != *settings)) {
+            router.reset();
+            router = make_unique<TransportRouter>(*version, *settings);
+            router_version = version;
+        }
+        if (reader.GetRenderSettings()) {
+            renderer.emplace(*reader.GetRenderSettings());
+        }
+        Writer writer(output, PrintMode::Compact);
+        reader.AnswerStatRequests(*version, router.get(), renderer ? &*renderer : nullptr, writer);
+    };
+    auto write_line = [&output]() {
+        output.push_back('\n');
+        cout.write(output.data(), static_cast<streamsize>(output.size()));
+    };
+
+    if (!input_path.empty()) {
+        JsonReader reader(threads);
+        ReadCommands(input_path, reader);
+        answer(reader);
+        if (output != "[]"sv) {
+            write_line();
+        }
+        cout.flush();
+    }
+
+    string line;
+    while (getline(cin, line)) {
+        if (line.find_first_not_of(" \t\r"sv) == string::npos) {
+            continue;
+        }
+        output.clear();
+        try {
+            JsonReader reader;
+            reader.ParseRequest(line);
+            answer(reader);
+        } catch (const exception& e) {
+            output.clear();
+            Dict error;
+            error["error_message"] = string(e.what());
+            Print(Document(error), output, PrintMode::Compact);
+        }
+        write_line();
+        if (cin.rdbuf()->in_avail() <= 0) {
+            cout.flush();
+        }
+    }
+    cout.flush();
+}
+
+// Строит справочник по запросам из файла или из stdin и сохраняет его двоичный снимок
+void Serialize(const string& input_path, size_t threads, const string& snapshot_path) {
+    CatalogueBuilder db;
+    JsonReader reader(threads);
+    ReadCommands(input_path, reader);
+    reader.ApplyBaseRequests(db);
+    ofstream out(snapshot_path, ios::binary);
+    SaveSnapshot(db.Freeze(), out);
+}
+
+// Отвечает на запросы к базе по отображённому в память снимку справочника.
+// Запросы на наполнение базы игнорируются
+void AnswerFromSnapshot(const string& input_path, size_t threads, const string& snapshot_path, Writer& writer) {
+    const CatalogueSnapshot snapshot(snapshot_path);
+    JsonReader reader(threads);
+    ReadCommands(input_path, reader);
+    reader.AnswerStatRequests(snapshot, writer);
+}
+
+void WriteOutput(const string& output) {
+    cout.write(output.data(), static_cast<streamsize>(output.size()));
+}
+
+}
+
+int main(int argc, char* argv[]) {
     /*
      * Примерная структура программы:
      *
@@ -16,10 +149,62 @@ int main() {
      * Построить на его основе JSON базу данных транспортного справочника
      * Выполнить запросы к справочнику, находящиеся в массива "stat_requests", построив JSON-массив
      * с ответами Вывести в stdout ответы в виде JSON
+     *
+     * Если передан путь к файлу, он отображается в память и разбирается без копирования,
+     * иначе запросы читаются из stdin. Флаг --compact включает вывод без пробельных символов,
+     * флаг --jsonl включает построчную обработку запросов (см. RunJsonLines).
+     * --serialize <файл> сохраняет построенный справочник в двоичный снимок,
+     * --snapshot <файл> отвечает на запросы по ранее сохранённому снимку.
+     * --threads <N> разбирает запросы и отвечает на них в N потоках, 0 - по числу аппаратных потоков
      */
-    TransportCatalogue db;
-    JsonReader reader;
-    reader.ParseCommands(cin);
-    const auto ans = reader.ApplyCommands(db);
-    Print(ans, cout);
+    ios::sync_with_stdio(false);
+
+    string input_path;
+    PrintMode mode = PrintMode::Pretty;
+    bool json_lines = false;
+    string serialize_path;
+    string snapshot_path;
+    size_t threads = 1;
+    for (int i = 1; i < argc; ++i) {
+        const string_view arg = argv[i];
+        if (arg == "--compact"sv) {
+            mode = PrintMode::Compact;
+        } else if (arg == "--jsonl"sv) {
+            json_lines = true;
+        } else if (arg == "--serialize"sv && i + 1 < argc) {
+            serialize_path = argv[++i];
+        } else if (arg == "--snapshot"sv && i + 1 < argc) {
+            snapshot_path = argv[++i];
+        } else if (arg == "--threads"sv && i + 1 < argc) {
+            threads = stoul(argv[++i]);
+            if (threads == 0) {
+                threads = GetDefaultThreadCount();
+            }
+        } else {
+            input_path = arg;
+        }
+    }
+
+    if (!serialize_path.empty()) {
+        Serialize(input_path, threads, serialize_path);
+        return 0;
+    }
+    if (!snapshot_path.empty()) {
+        string output;
+        Writer writer(output, mode);
+        AnswerFromSnapshot(input_path, threads, snapshot_path, writer);
+        WriteOutput(output);
+        return 0;
+    }
+
+    if (json_lines) {
+        RunJsonLines(input_path, threads);
+        return 0;
+    }
+
+    CatalogueBuilder db;
+    string output;
+    Writer writer(output, mode);
+    ProcessDocument(input_path, threads, db, writer);
+    WriteOutput(output);
 }
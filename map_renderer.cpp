@@ -1,21 +1,658 @@
 #include "map_renderer.h"
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
 /*
  * В этом файле вы можете разместить код, отвечающий за визуализацию карты маршрутов в формате SVG.
  * Визуализация маршртутов вам понадобится во второй части итогового проекта.
  * Пока можете оставить файл пустым.
  */
 
+using namespace std::literals;
+
 namespace renderer {
-    void MapRenderer::AddObject(std::unique_ptr<svg::Drawable>&& obj) {
-        objects_.push_back(std::move(obj));
+
+namespace {
+
+// Разброс координат меньше этого считается нулевым
+constexpr double kEpsilon = 1e-6;
+
+const std::string kFontFamily = "Verdana"s;
+const std::string kStopSymbol = "stop"s;
+
+// Ширина текста не измеряется. Оценка сверху: символ Verdana не шире 1.1 кегля,
+// а байтов UTF-8 в названии не меньше, чем символов
+constexpr double kGlyphWidth = 1.1;
+// Буквы опускаются ниже базовой линии не больше чем на половину кегля
+constexpr double kDescent = 0.5;
+
+// Размер сетки отрезков выбирается так, чтобы отрезок в среднем проходил не больше чем через kCellsPerSegment ячеек
+constexpr double kCellsPerSegment = 8.0;
+constexpr uint32_t kMaxGridSize = 1024;
+
+struct Rect {
+    double min_x;
+    double min_y;
+    double max_x;
+    double max_y;
+
+    bool Intersects(const Rect& other) const {
+        return min_x <= other.max_x && other.min_x <= max_x && min_y <= other.max_y && other.min_y <= max_y;
+    }
+
+    Rect Expanded(double margin) const {
+        return {min_x - margin, min_y - margin, max_x + margin, max_y + margin};
+    }
+
+    Rect Union(const Rect& other) const {
+        return {std::min(min_x, other.min_x), std::min(min_y, other.min_y),
+                std::max(max_x, other.max_x), std::max(max_y, other.max_y)};
+    }
+};
+
+Rect ToRect(const svg::ViewBox& box) {
+    return {box.min.x, box.min.y, box.min.x + box.width, box.min.y + box.height};
+}
+
+// Прямоугольник, в котором заведомо помещается надпись из length байтов вместе с подложкой
+Rect TextBounds(svg::Point position, svg::Point offset, int font_size, size_t length, double underlayer_width) {
+    const double x = position.x + offset.x;
+    const double y = position.y + offset.y;
+    const Rect text {x, y - font_size, x + static_cast<double>(length) * font_size * kGlyphWidth, y + font_size * kDescent};
+    return text.Expanded(underlayer_width / 2);
+}
+
+// Отрезок ab пересекает прямоугольник, если пересекаются их габариты
+// и вершины прямоугольника не лежат строго по одну сторону от прямой ab
+bool SegmentIntersects(svg::Point a, svg::Point b, const Rect& rect) {
+    if (!rect.Intersects({std::min(a.x, b.x), std::min(a.y, b.y), std::max(a.x, b.x), std::max(a.y, b.y)})) {
+        return false;
+    }
+    const auto side = [&](double x, double y) {
+        return (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x);
+    };
+    const double sides[] = {side(rect.min_x, rect.min_y), side(rect.max_x, rect.min_y),
+                            side(rect.min_x, rect.max_y), side(rect.max_x, rect.max_y)};
+    return !std::all_of(std::begin(sides), std::end(sides), [](double v) { return v > 0.0; })
+        && !std::all_of(std::begin(sides), std::end(sides), [](double v) { return v < 0.0; });
+}
+
+// Обходит отрезки маршрута. Маршрут из одной остановки - отрезок нулевой длины
+template <typename Visit>
+void ForEachSegment(std::span<const transport::StopId> route, const std::vector<svg::Point>& positions, Visit&& visit) {
+    if (route.size() == 1) {
+        visit(positions[route[0]], positions[route[0]]);
+    }
+    for (size_t i = 1; i < route.size(); ++i) {
+        visit(positions[route[i - 1]], positions[route[i]]);
+    }
+}
+
+// Обходит надписи маршрута с остановками: у первой конечной надпись задаётся числом 2 * bus,
+// у второй конечной некольцевого маршрута - 2 * bus + 1
+template <typename Visit>
+void ForEachBusLabel(const transport::FrozenCatalogue& catalogue, transport::BusId bus, Visit&& visit) {
+    const auto route = catalogue.GetRoute(bus);
+    visit(route.front(), 2 * bus);
+    // Некольцевой маршрут хранится туда и обратно, его вторая конечная - в середине
+    const auto last = route[route.size() / 2];
+    if (!catalogue.IsRoundtrip(bus) && last != route.front()) {
+        visit(last, 2 * bus + 1);
+    }
+}
+
+}
+
+// Данные карты, не зависящие от выводимой области
+struct MapRenderer::Layout {
+    Layout(uint64_t revision, SphereProjector project)
+        : revision(revision)
+        , project(project) {
+    }
+
+    uint64_t revision;
+    SphereProjector project;
+    // Остановки, через которые проходят маршруты, и их положение на холсте
+    std::vector<bool> used;
+    std::vector<svg::Point> positions;
+    // Номер цвета маршрута в палитре. Цвета получают только маршруты с остановками
+    std::vector<uint32_t> bus_colors;
+
+    // Индекс для рисования части карты строится только по запросу плитки или прямоугольника
+    bool has_index = false;
+    // Надписи маршрутов у остановки stop: bus_labels[label_offsets[stop], label_offsets[stop + 1]),
+    // см. ForEachBusLabel
+    std::vector<uint32_t> label_offsets;
+    std::vector<uint32_t> bus_labels;
+    // Прямоугольник относительно положения остановки, в котором помещаются её кружок и надписи
+    Rect stop_reach {};
+    // Холст делится на grid_size x grid_size ячеек. Маршруты, отрезки которых проходят через ячейку cell:
+    // cell_buses[cell_offsets[cell], cell_offsets[cell + 1])
+    uint32_t grid_size = 1;
+    double cell_width = 0.0;
+    double cell_height = 0.0;
+    std::vector<uint32_t> cell_offsets;
+    std::vector<transport::BusId> cell_buses;
+
+    uint32_t GetColumn(double x) const {
+        return static_cast<uint32_t>(std::clamp(std::floor(x / cell_width), 0.0, grid_size - 1.0));
+    }
+
+    uint32_t GetRow(double y) const {
+        return static_cast<uint32_t>(std::clamp(std::floor(y / cell_height), 0.0, grid_size - 1.0));
+    }
+
+    // Обходит ячейки, через которые проходит отрезок ab, по столбцам. Ячейки, которых отрезок
+    // касается с точностью до kEpsilon, тоже обходятся
+    template <typename Visit>
+    void VisitCells(svg::Point a, svg::Point b, Visit&& visit) const {
+        if (a.x > b.x) {
+            std::swap(a, b);
+        }
+        const uint32_t first = GetColumn(a.x - kEpsilon);
+        const uint32_t last = GetColumn(b.x + kEpsilon);
+        for (uint32_t column = first; column <= last; ++column) {
+            double min_y = std::min(a.y, b.y);
+            double max_y = std::max(a.y, b.y);
+            if (b.x - a.x > kEpsilon) {
+                const auto at = [&](double x) {
+                    return a.y + (std::clamp(x, a.x, b.x) - a.x) / (b.x - a.x) * (b.y - a.y);
+                };
+                const double y0 = at(column * cell_width);
+                const double y1 = at((column + 1) * cell_width);
+                min_y = std::min(y0, y1);
+                max_y = std::max(y0, y1);
+            }
+            const uint32_t last_row = GetRow(max_y + kEpsilon);
+            for (uint32_t row = GetRow(min_y - kEpsilon); row <= last_row; ++row) {
+                visit(row * grid_size + column);
+            }
+        }
+    }
+};
+
+// Элементы каждого слоя в порядке вывода
+struct MapRenderer::Selection {
+    std::vector<transport::BusId> lines;
+    std::vector<uint32_t> bus_labels;
+    std::vector<transport::StopId> stops;
+    std::vector<transport::StopId> stop_labels;
+};
+
+SphereProjector::SphereProjector(double min_lat, double max_lat, double min_lng, double max_lng,
+                                 double width, double height, double padding)
+    : padding_(padding)
+    , min_lng_(min_lng)
+    , max_lat_(max_lat) {
+    if (min_lat > max_lat) {
+        // Точек нет
+        return;
+    }
+    const bool has_width = max_lng - min_lng >= kEpsilon;
+    const bool has_height = max_lat - min_lat >= kEpsilon;
+    const double width_zoom = has_width ? (width - 2 * padding) / (max_lng - min_lng) : 0.0;
+    const double height_zoom = has_height ? (height - 2 * padding) / (max_lat - min_lat) : 0.0;
+    if (has_width && has_height) {
+        zoom_ = std::min(width_zoom, height_zoom);
+    } else if (has_width) {
+        zoom_ = width_zoom;
+    } else if (has_height) {
+        zoom_ = height_zoom;
+    }
+}
+
+svg::Point SphereProjector::operator()(geo::Coordinates place) const {
+    return {(place.lng - min_lng_) * zoom_ + padding_, (max_lat_ - place.lat) * zoom_ + padding_};
+}
+
+std::optional<geo::Coordinates> SphereProjector::Unproject(svg::Point point) const {
+    if (zoom_ == 0.0) {
+        return std::nullopt;
+    }
+    return geo::Coordinates {max_lat_ - (point.y - padding_) / zoom_, (point.x - padding_) / zoom_ + min_lng_};
+}
+
+size_t MapRenderer::TileKeyHasher::operator()(const TileKey& key) const {
+    // Номера плитки не длиннее kMaxZoom бит
+    const uint64_t tile = (static_cast<uint64_t>(key.tile.zoom) << 48)
+        | (static_cast<uint64_t>(key.tile.x) << kMaxZoom) | static_cast<uint64_t>(key.tile.y);
+    return std::hash<uint64_t>{}(key.revision * 0x9e3779b97f4a7c15ull ^ tile);
+}
+
+MapRenderer::MapRenderer(RenderSettings settings)
+    : settings_(std::move(settings)) {
+    if (!(settings_.width > 0.0) || !(settings_.height > 0.0) || settings_.padding < 0.0
+        || 2 * settings_.padding > std::min(settings_.width, settings_.height) || settings_.color_palette.empty()
+        || settings_.coordinate_precision > svg::RenderOptions::kMaxPrecision || settings_.path_min_points < 0
+        || settings_.tile_cache_size < 0) {
+        throw std::invalid_argument("invalid render settings");
+    }
+    options_.precision = settings_.coordinate_precision;
+    options_.min_path_points = static_cast<size_t>(settings_.path_min_points);
+    options_.css_classes = settings_.css_classes;
+
+    // Элементы с одинаковым оформлением ссылаются на общие стили
+    for (const auto& color : settings_.color_palette) {
+        svg::Style line;
+        line.fill = svg::NoneColor;
+        line.stroke = color.value;
+        line.stroke_width = settings_.line_width;
+        line.stroke_linecap = svg::StrokeLineCap::ROUND;
+        line.stroke_linejoin = svg::StrokeLineJoin::ROUND;
+        line_styles_.push_back(std::make_shared<const svg::Style>(std::move(line)));
+        svg::Style label;
+        label.fill = color.value;
+        bus_label_styles_.push_back(std::make_shared<const svg::Style>(std::move(label)));
+    }
+    svg::Style underlayer;
+    underlayer.fill = settings_.underlayer_color.value;
+    underlayer.stroke = settings_.underlayer_color.value;
+    underlayer.stroke_width = settings_.underlayer_width;
+    underlayer.stroke_linecap = svg::StrokeLineCap::ROUND;
+    underlayer.stroke_linejoin = svg::StrokeLineJoin::ROUND;
+    underlayer_style_ = std::make_shared<const svg::Style>(std::move(underlayer));
+    svg::Style stop;
+    stop.fill = "white"s;
+    stop_style_ = std::make_shared<const svg::Style>(std::move(stop));
+    svg::Style stop_label;
+    stop_label.fill = "black"s;
+    stop_label_style_ = std::make_shared<const svg::Style>(std::move(stop_label));
+}
+
+const RenderSettings& MapRenderer::GetSettings() const {
+    return settings_;
+}
+
+TileCacheCounters MapRenderer::GetTileCacheCounters() const {
+    std::lock_guard guard(cache_mutex_);
+    return tile_cache_counters_;
+}
+
+void MapRenderer::RenderMap(const transport::FrozenCatalogue& catalogue, std::ostream& out) const {
+    const auto layout = GetLayout(catalogue, false);
+    svg::DocumentStream doc(out, options_);
+    RenderLayers(catalogue, *layout, SelectAll(catalogue, *layout), doc);
+    doc.Close();
+}
+
+void MapRenderer::RenderMap(const transport::FrozenCatalogue& catalogue, std::string& out) const {
+    const auto layout = GetLayout(catalogue, false);
+    svg::DocumentStream doc(out, options_);
+    RenderLayers(catalogue, *layout, SelectAll(catalogue, *layout), doc);
+    doc.Close();
+}
+
+bool MapRenderer::RenderTile(const transport::FrozenCatalogue& catalogue, MapTile tile, std::string& out) const {
+    if (tile.zoom < 0 || tile.zoom > kMaxZoom) {
+        return false;
+    }
+    const int count = 1 << tile.zoom;
+    if (tile.x < 0 || tile.y < 0 || tile.x >= count || tile.y >= count) {
+        return false;
+    }
+    const TileKey key {catalogue.GetRevision(), tile};
+    std::shared_ptr<const std::string> rendered;
+    {
+        std::lock_guard guard(cache_mutex_);
+        if (const auto it = tile_index_.find(key); it != tile_index_.end()) {
+            tiles_.splice(tiles_.begin(), tiles_, it->second);
+            rendered = it->second->second;
+            ++tile_cache_counters_.hits;
+        } else {
+            ++tile_cache_counters_.misses;
+        }
+    }
+    if (!rendered) {
+        // Плитка рисуется без блокировки, одну плитку могут одновременно нарисовать несколько потоков
+        const double width = settings_.width / count;
+        const double height = settings_.height / count;
+        std::string svg;
+        RenderPart(catalogue, *GetLayout(catalogue, true), {{tile.x * width, tile.y * height}, width, height}, svg);
+        rendered = std::make_shared<const std::string>(std::move(svg));
+
+        const auto capacity = static_cast<size_t>(settings_.tile_cache_size);
+        std::lock_guard guard(cache_mutex_);
+        if (capacity > 0 && !tile_index_.contains(key)) {
+            tiles_.emplace_front(key, rendered);
+            tile_index_.emplace(key, tiles_.begin());
+            if (tiles_.size() > capacity) {
+                tile_index_.erase(tiles_.back().first);
+                tiles_.pop_back();
+            }
+        }
+    }
+    out += *rendered;
+    return true;
+}
+
+bool MapRenderer::RenderBox(const transport::FrozenCatalogue& catalogue, const MapBox& box, std::string& out) const {
+    if (box.min_place.lat > box.max_place.lat || box.min_place.lng > box.max_place.lng) {
+        return false;
+    }
+    const auto layout = GetLayout(catalogue, true);
+    const svg::Point top_left = layout->project({box.max_place.lat, box.min_place.lng});
+    const svg::Point bottom_right = layout->project({box.min_place.lat, box.max_place.lng});
+    RenderPart(catalogue, *layout, {top_left, bottom_right.x - top_left.x, bottom_right.y - top_left.y}, out);
+    return true;
+}
+
+void MapRenderer::RenderPart(const transport::FrozenCatalogue& catalogue, const Layout& layout,
+                             const svg::ViewBox& rect, std::string& out) const {
+    svg::DocumentStream doc(out, options_, rect);
+    RenderLayers(catalogue, layout, SelectInRect(catalogue, layout, rect), doc);
+    doc.Close();
+}
+
+std::shared_ptr<const MapRenderer::Layout> MapRenderer::GetLayout(const transport::FrozenCatalogue& catalogue,
+                                                                   bool with_index) const {
+    {
+        std::lock_guard guard(cache_mutex_);
+        if (layout_ && layout_->revision == catalogue.GetRevision() && (layout_->has_index || !with_index)) {
+            return layout_;
+        }
+    }
+    auto layout = BuildLayout(catalogue, with_index);
+    std::lock_guard guard(cache_mutex_);
+    layout_ = layout;
+    return layout;
+}
+
+std::shared_ptr<const MapRenderer::Layout> MapRenderer::BuildLayout(const transport::FrozenCatalogue& catalogue,
+                                                                     bool with_index) const {
+    using transport::BusId;
+    using transport::StopId;
+
+    const size_t stop_count = catalogue.GetStopCount();
+    const size_t bus_count = catalogue.GetBusCount();
+    std::vector<bool> used(stop_count);
+    for (BusId bus = 0; bus < bus_count; ++bus) {
+        for (const auto stop : catalogue.GetRoute(bus)) {
+            used[stop] = true;
+        }
+    }
+    // Границы проекции находятся за один проход по координатам остановок
+    double min_lat = std::numeric_limits<double>::infinity();
+    double max_lat = -std::numeric_limits<double>::infinity();
+    double min_lng = std::numeric_limits<double>::infinity();
+    double max_lng = -std::numeric_limits<double>::infinity();
+    for (StopId stop = 0; stop < stop_count; ++stop) {
+        if (!used[stop]) {
+            continue;
+        }
+        const auto place = catalogue.GetStopPlace(stop);
+        min_lat = std::min(min_lat, place.lat);
+        max_lat = std::max(max_lat, place.lat);
+        min_lng = std::min(min_lng, place.lng);
+        max_lng = std::max(max_lng, place.lng);
+    }
+    auto layout = std::make_shared<Layout>(catalogue.GetRevision(),
+        SphereProjector(min_lat, max_lat, min_lng, max_lng, settings_.width, settings_.height, settings_.padding));
+    Layout& result = *layout;
+
+    result.positions.resize(stop_count);
+    for (StopId stop = 0; stop < stop_count; ++stop) {
+        if (used[stop]) {
+            result.positions[stop] = result.project(catalogue.GetStopPlace(stop));
+        }
+    }
+    result.used = std::move(used);
+    uint32_t color = 0;
+    result.bus_colors.resize(bus_count);
+    for (BusId bus = 0; bus < bus_count; ++bus) {
+        if (!catalogue.GetRoute(bus).empty()) {
+            result.bus_colors[bus] = color++ % settings_.color_palette.size();
+        }
+    }
+    if (!with_index) {
+        return layout;
+    }
+    result.has_index = true;
+
+    // Надписи маршрутов и отрезки для выбора размера сетки
+    size_t max_stop_name = 0;
+    for (StopId stop = 0; stop < stop_count; ++stop) {
+        if (result.used[stop]) {
+            max_stop_name = std::max(max_stop_name, catalogue.GetStopName(stop).size());
+        }
+    }
+    size_t max_bus_name = 0;
+    size_t segments = 0;
+    double length_x = 0.0;
+    double length_y = 0.0;
+    result.label_offsets.assign(stop_count + 1, 0);
+    std::vector<std::pair<StopId, uint32_t>> labels;
+    for (BusId bus = 0; bus < bus_count; ++bus) {
+        const auto route = catalogue.GetRoute(bus);
+        if (route.empty()) {
+            continue;
+        }
+        max_bus_name = std::max(max_bus_name, catalogue.GetBusName(bus).size());
+        ForEachBusLabel(catalogue, bus, [&](StopId stop, uint32_t label) {
+            labels.emplace_back(stop, label);
+        });
+        ForEachSegment(route, result.positions, [&](svg::Point a, svg::Point b) {
+            ++segments;
+            length_x += std::abs(b.x - a.x);
+            length_y += std::abs(b.y - a.y);
+        });
+    }
+    std::sort(labels.begin(), labels.end());
+    result.bus_labels.reserve(labels.size());
+    for (const auto& [stop, label] : labels) {
+        ++result.label_offsets[stop + 1];
+        result.bus_labels.push_back(label);
+    }
+    for (size_t stop = 0; stop < stop_count; ++stop) {
+        result.label_offsets[stop + 1] += result.label_offsets[stop];
+    }
+
+    // Надписи выступают в основном вправо, поэтому запас для поиска остановок у каждой стороны свой
+    const double radius = settings_.stop_radius;
+    result.stop_reach = Rect {-radius, -radius, radius, radius}
+        .Union(TextBounds({}, settings_.stop_label_offset, settings_.stop_label_font_size, max_stop_name,
+                          settings_.underlayer_width))
+        .Union(TextBounds({}, settings_.bus_label_offset, settings_.bus_label_font_size, max_bus_name,
+                          settings_.underlayer_width));
+
+    // Отрезок проходит примерно через 1 + grid_size * (|dx| / width + |dy| / height) ячеек
+    const double cells_per_size = length_x / settings_.width + length_y / settings_.height;
+    while (result.grid_size < kMaxGridSize) {
+        const double next = 2.0 * result.grid_size;
+        if (segments + next * cells_per_size > kCellsPerSegment * segments || next * next > kCellsPerSegment * segments) {
+            break;
+        }
+        result.grid_size *= 2;
+    }
+    result.cell_width = settings_.width / result.grid_size;
+    result.cell_height = settings_.height / result.grid_size;
+
+    // Сетка заполняется в два прохода: подсчёт маршрутов в ячейках и раскладка.
+    // Маршрут записывается в ячейку один раз, даже если через неё проходят несколько его отрезков
+    const size_t cell_count = static_cast<size_t>(result.grid_size) * result.grid_size;
+    result.cell_offsets.assign(cell_count + 1, 0);
+    std::vector<BusId> last_bus(cell_count, std::numeric_limits<BusId>::max());
+    const auto visit_buses = [&](auto&& visit) {
+        for (BusId bus = 0; bus < bus_count; ++bus) {
+            ForEachSegment(catalogue.GetRoute(bus), result.positions, [&](svg::Point a, svg::Point b) {
+                result.VisitCells(a, b, [&](uint32_t cell) {
+                    if (last_bus[cell] != bus) {
+                        last_bus[cell] = bus;
+                        visit(cell, bus);
+                    }
+                });
+            });
+        }
+    };
+    visit_buses([&](uint32_t cell, BusId) {
+        ++result.cell_offsets[cell + 1];
+    });
+    for (size_t cell = 0; cell < cell_count; ++cell) {
+        result.cell_offsets[cell + 1] += result.cell_offsets[cell];
+    }
+    result.cell_buses.resize(result.cell_offsets.back());
+    std::vector<uint32_t> filled(result.cell_offsets.begin(), result.cell_offsets.end() - 1);
+    std::fill(last_bus.begin(), last_bus.end(), std::numeric_limits<BusId>::max());
+    visit_buses([&](uint32_t cell, BusId bus) {
+        result.cell_buses[filled[cell]++] = bus;
+    });
+    return layout;
+}
+
+MapRenderer::Selection MapRenderer::SelectAll(const transport::FrozenCatalogue& catalogue, const Layout& layout) const {
+    Selection selection;
+    for (transport::BusId bus = 0; bus < catalogue.GetBusCount(); ++bus) {
+        if (!catalogue.GetRoute(bus).empty()) {
+            selection.lines.push_back(bus);
+            ForEachBusLabel(catalogue, bus, [&](transport::StopId, uint32_t label) {
+                selection.bus_labels.push_back(label);
+            });
+        }
+    }
+    for (transport::StopId stop = 0; stop < layout.used.size(); ++stop) {
+        if (layout.used[stop]) {
+            selection.stops.push_back(stop);
+        }
+    }
+    selection.stop_labels = selection.stops;
+    return selection;
+}
+
+MapRenderer::Selection MapRenderer::SelectInRect(const transport::FrozenCatalogue& catalogue, const Layout& layout,
+                                                 const svg::ViewBox& rect) const {
+    Selection selection;
+    const Rect area = ToRect(rect);
+
+    // Маршруты-кандидаты берутся из ячеек сетки под областью, расширенной на половину толщины линии
+    const Rect line_area = area.Expanded(settings_.line_width / 2);
+    std::vector<bool> seen(catalogue.GetBusCount());
+    const uint32_t last_row = layout.GetRow(line_area.max_y);
+    const uint32_t last_column = layout.GetColumn(line_area.max_x);
+    for (uint32_t row = layout.GetRow(line_area.min_y); row <= last_row; ++row) {
+        for (uint32_t column = layout.GetColumn(line_area.min_x); column <= last_column; ++column) {
+            const uint32_t cell = row * layout.grid_size + column;
+            for (uint32_t i = layout.cell_offsets[cell]; i < layout.cell_offsets[cell + 1]; ++i) {
+                const auto bus = layout.cell_buses[i];
+                if (!seen[bus]) {
+                    seen[bus] = true;
+                    selection.lines.push_back(bus);
+                }
+            }
+        }
+    }
+    std::sort(selection.lines.begin(), selection.lines.end());
+    std::erase_if(selection.lines, [&](transport::BusId bus) {
+        bool crosses = false;
+        ForEachSegment(catalogue.GetRoute(bus), layout.positions, [&](svg::Point a, svg::Point b) {
+            crosses = crosses || SegmentIntersects(a, b, line_area);
+        });
+        return !crosses;
+    });
+
+    // Остановки ищутся в прямоугольнике координат с запасом на размер их надписей,
+    // затем кружок и каждая надпись проверяются отдельно. Запас в единицу холста покрывает
+    // погрешность обратной проекции
+    const Rect& reach = layout.stop_reach;
+    const Rect stop_area = Rect {area.min_x - reach.max_x, area.min_y - reach.max_y,
+                                 area.max_x - reach.min_x, area.max_y - reach.min_y}.Expanded(1.0);
+    geo::Coordinates min {-90.0, -180.0};
+    geo::Coordinates max {90.0, 180.0};
+    const auto top_left = layout.project.Unproject({stop_area.min_x, stop_area.min_y});
+    const auto bottom_right = layout.project.Unproject({stop_area.max_x, stop_area.max_y});
+    if (top_left && bottom_right) {
+        min = {bottom_right->lat, top_left->lng};
+        max = {top_left->lat, bottom_right->lng};
+    }
+    for (const auto stop : catalogue.GetStopIndex().FindInBox(min, max)) {
+        if (!layout.used[stop]) {
+            continue;
+        }
+        const svg::Point position = layout.positions[stop];
+        const double radius = settings_.stop_radius;
+        if (area.Intersects({position.x - radius, position.y - radius, position.x + radius, position.y + radius})) {
+            selection.stops.push_back(stop);
+        }
+        if (area.Intersects(TextBounds(position, settings_.stop_label_offset, settings_.stop_label_font_size,
+                                       catalogue.GetStopName(stop).size(), settings_.underlayer_width))) {
+            selection.stop_labels.push_back(stop);
+        }
+        for (uint32_t i = layout.label_offsets[stop]; i < layout.label_offsets[stop + 1]; ++i) {
+            const uint32_t label = layout.bus_labels[i];
+            if (area.Intersects(TextBounds(position, settings_.bus_label_offset, settings_.bus_label_font_size,
+                                           catalogue.GetBusName(label / 2).size(), settings_.underlayer_width))) {
+                selection.bus_labels.push_back(label);
+            }
+        }
+    }
+    std::sort(selection.bus_labels.begin(), selection.bus_labels.end());
+    return selection;
+}
+
+void MapRenderer::RenderLayers(const transport::FrozenCatalogue& catalogue, const Layout& layout,
+                               const Selection& selection, svg::DocumentStream& doc) const {
+    for (const auto bus : selection.lines) {
+        svg::Polyline line;
+        for (const auto stop : catalogue.GetRoute(bus)) {
+            line.AddPoint(layout.positions[stop]);
+        }
+        doc.Render(line.SetStyle(line_styles_[layout.bus_colors[bus]]));
+    }
+
+    for (const auto label : selection.bus_labels) {
+        const auto bus = label / 2;
+        const auto route = catalogue.GetRoute(bus);
+        const auto stop = label % 2 == 0 ? route.front() : route[route.size() / 2];
+        RenderBusLabel(doc, layout.positions[stop], catalogue.GetBusName(bus), bus_label_styles_[layout.bus_colors[bus]]);
+    }
+
+    if (settings_.stop_symbols) {
+        // Кружок остановки описывается один раз, остановки ссылаются на него
+        svg::Symbol marker(kStopSymbol);
+        marker.Add(svg::Circle().SetRadius(settings_.stop_radius).SetStyle(stop_style_));
+        doc.Render(marker);
     }
-    
-    const svg::Document MapRenderer::GetDocument() const {
-        svg::Document doc;
-        for (auto& it : objects_) {
-            it->Draw(doc);
+    for (const auto stop : selection.stops) {
+        if (settings_.stop_symbols) {
+            doc.Render(svg::Use().SetSymbol(kStopSymbol).SetPosition(layout.positions[stop]));
+        } else {
+            doc.Render(svg::Circle().SetCenter(layout.positions[stop]).SetRadius(settings_.stop_radius).SetStyle(stop_style_));
         }
-        return doc;
     }
+
+    for (const auto stop : selection.stop_labels) {
+        RenderStopLabel(doc, layout.positions[stop], catalogue.GetStopName(stop));
+    }
+}
+
+void MapRenderer::RenderBusLabel(svg::DocumentStream& doc, svg::Point position, std::string_view bus,
+                                 const std::shared_ptr<const svg::Style>& style) const {
+    svg::Text text;
+    text.SetPosition(position)
+        .SetOffset(settings_.bus_label_offset)
+        .SetFontSize(static_cast<uint32_t>(settings_.bus_label_font_size))
+        .SetFontFamily(kFontFamily)
+        .SetFontWeight("bold"s)
+        .SetData(std::string(bus));
+    // Подложка выводится под надписью тем же текстом
+    doc.Render(text.SetStyle(underlayer_style_));
+    doc.Render(text.SetStyle(style));
+}
+
+void MapRenderer::RenderStopLabel(svg::DocumentStream& doc, svg::Point position, std::string_view stop) const {
+    svg::Text text;
+    text.SetPosition(position)
+        .SetOffset(settings_.stop_label_offset)
+        .SetFontSize(static_cast<uint32_t>(settings_.stop_label_font_size))
+        .SetFontFamily(kFontFamily)
+        .SetData(std::string(stop));
+    doc.Render(text.SetStyle(underlayer_style_));
+    doc.Render(text.SetStyle(stop_label_style_));
+}
+
 }
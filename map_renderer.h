@@ -1,8 +1,18 @@
 #pragma once
 
+#include "domain.h"
 #include "svg.h"
+#include "transport_catalogue.h"
 
+#include <cstdint>
+#include <list>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 /*
  * В этом файле вы можете разместить код, отвечающий за визуализацию карты маршрутов в формате SVG.
@@ -11,13 +21,165 @@
  */
 
 namespace renderer {
-    
+
+    // Цвет задаётся названием либо массивом [r, g, b] или [r, g, b, opacity].
+    // Хранится в виде значения атрибута SVG
+    struct RenderColor {
+        svg::Color value;
+    };
+
+    /*
+     * Настройки отрисовки карты: размеры холста и отступ от его краёв, толщина линий маршрутов,
+     * радиус кружков остановок, размеры шрифтов и смещения надписей [dx, dy],
+     * цвет и толщина подложки под надписями и палитра цветов маршрутов.
+     * Необязательные coordinate_precision и path_min_points задают формат вывода (см. svg::RenderOptions),
+     * css_classes заменяет атрибуты оформления CSS-классами, stop_symbols выводит кружки остановок
+     * ссылками <use> на один шаблон <symbol>. tile_cache_size - сколько последних нарисованных плиток
+     * хранит визуализатор, 0 отключает кэш
+     */
+    struct RenderSettings {
+        double width = 0.0;
+        double height = 0.0;
+        double padding = 0.0;
+        double line_width = 0.0;
+        double stop_radius = 0.0;
+        int bus_label_font_size = 0;
+        svg::Point bus_label_offset;
+        int stop_label_font_size = 0;
+        svg::Point stop_label_offset;
+        RenderColor underlayer_color;
+        double underlayer_width = 0.0;
+        std::vector<RenderColor> color_palette;
+        int coordinate_precision = -1;
+        int path_min_points = 0;
+        bool css_classes = false;
+        bool stop_symbols = false;
+        int tile_cache_size = 256;
+
+        static constexpr std::tuple kFields {
+            Field {"width", &RenderSettings::width},
+            Field {"height", &RenderSettings::height},
+            Field {"padding", &RenderSettings::padding},
+            Field {"line_width", &RenderSettings::line_width},
+            Field {"stop_radius", &RenderSettings::stop_radius},
+            Field {"bus_label_font_size", &RenderSettings::bus_label_font_size},
+            Field {"bus_label_offset", &RenderSettings::bus_label_offset},
+            Field {"stop_label_font_size", &RenderSettings::stop_label_font_size},
+            Field {"stop_label_offset", &RenderSettings::stop_label_offset},
+            Field {"underlayer_color", &RenderSettings::underlayer_color},
+            Field {"underlayer_width", &RenderSettings::underlayer_width},
+            Field {"color_palette", &RenderSettings::color_palette},
+            Field {"coordinate_precision", &RenderSettings::coordinate_precision, Presence::Optional},
+            Field {"path_min_points", &RenderSettings::path_min_points, Presence::Optional},
+            Field {"css_classes", &RenderSettings::css_classes, Presence::Optional},
+            Field {"stop_symbols", &RenderSettings::stop_symbols, Presence::Optional},
+            Field {"tile_cache_size", &RenderSettings::tile_cache_size, Presence::Optional},
+        };
+    };
+
+    struct TileCacheCounters {
+        size_t hits = 0;
+        size_t misses = 0;
+    };
+
+    /*
+     * Проецирует широту и долготу на холст: долгота растёт вправо, широта вверх.
+     * Масштаб выбирается так, чтобы все точки поместились в холст с отступом padding
+     */
+    class SphereProjector {
+    public:
+        SphereProjector(double min_lat, double max_lat, double min_lng, double max_lng,
+                        double width, double height, double padding);
+
+        svg::Point operator()(geo::Coordinates place) const;
+        // Обратное преобразование. Не определено, если все точки проецируются в одну
+        std::optional<geo::Coordinates> Unproject(svg::Point point) const;
+
+    private:
+        double padding_;
+        double min_lng_;
+        double max_lat_;
+        double zoom_ = 0.0;
+    };
+
+    /*
+     * Рисует карту маршрутов справочника слоями: линии маршрутов, названия маршрутов,
+     * кружки остановок и названия остановок. Маршруты и остановки выводятся в алфавитном порядке,
+     * на карту попадают только остановки, через которые проходят маршруты.
+     * Элементы выводятся в поток по мере построения, документ целиком в памяти не хранится.
+     *
+     * Часть карты (плитка или прямоугольник координат) рисуется в тех же координатах холста, что и вся карта,
+     * и ограничивается атрибутом viewBox. В неё попадают только элементы, пересекающие область:
+     * остановки находятся через пространственный индекс справочника, линии маршрутов - через сетку отрезков.
+     * Проекция, сетка и другие данные, не зависящие от области, строятся один раз для ревизии справочника.
+     * Нарисованные плитки хранятся в LRU-кэше с ключом из ревизии и номера плитки, поэтому визуализатор
+     * должен получать версии одного CatalogueBuilder. Методы можно вызывать из нескольких потоков
+     */
     class MapRenderer {
     public:
-        void AddObject(std::unique_ptr<svg::Drawable>&& obj);
-        const svg::Document GetDocument() const;
+        // Бросает invalid_argument при некорректных настройках
+        explicit MapRenderer(RenderSettings settings);
+
+        void RenderMap(const transport::FrozenCatalogue& catalogue, std::ostream& out) const;
+        // Дописывает карту в конец буфера
+        void RenderMap(const transport::FrozenCatalogue& catalogue, std::string& out) const;
+        // Дописывает плитку в конец буфера. Возвращает false, если плитки с такими номерами нет
+        bool RenderTile(const transport::FrozenCatalogue& catalogue, MapTile tile, std::string& out) const;
+        // Дописывает часть карты в конец буфера. Возвращает false, если границы перепутаны
+        bool RenderBox(const transport::FrozenCatalogue& catalogue, const MapBox& box, std::string& out) const;
+
+        const RenderSettings& GetSettings() const;
+        // Сколько плиток взято из кэша и сколько нарисовано заново
+        TileCacheCounters GetTileCacheCounters() const;
+
+        static constexpr int kMaxZoom = 24;
+
     private:
-        std::vector<std::unique_ptr<svg::Drawable>> objects_;
+        struct Layout;
+        struct Selection;
+
+        struct TileKey {
+            uint64_t revision;
+            MapTile tile;
+
+            bool operator==(const TileKey&) const = default;
+        };
+
+        struct TileKeyHasher {
+            size_t operator()(const TileKey& key) const;
+        };
+
+        using TileCache = std::list<std::pair<TileKey, std::shared_ptr<const std::string>>>;
+
+        // with_index - нужны данные для рисования части карты
+        std::shared_ptr<const Layout> GetLayout(const transport::FrozenCatalogue& catalogue, bool with_index) const;
+        std::shared_ptr<const Layout> BuildLayout(const transport::FrozenCatalogue& catalogue, bool with_index) const;
+        Selection SelectAll(const transport::FrozenCatalogue& catalogue, const Layout& layout) const;
+        Selection SelectInRect(const transport::FrozenCatalogue& catalogue, const Layout& layout,
+                               const svg::ViewBox& rect) const;
+        void RenderLayers(const transport::FrozenCatalogue& catalogue, const Layout& layout,
+                          const Selection& selection, svg::DocumentStream& doc) const;
+        void RenderPart(const transport::FrozenCatalogue& catalogue, const Layout& layout,
+                        const svg::ViewBox& rect, std::string& out) const;
+        void RenderBusLabel(svg::DocumentStream& doc, svg::Point position, std::string_view bus,
+                            const std::shared_ptr<const svg::Style>& style) const;
+        void RenderStopLabel(svg::DocumentStream& doc, svg::Point position, std::string_view stop) const;
+
+        RenderSettings settings_;
+        svg::RenderOptions options_;
+        // Стили линий и названий маршрутов по цветам палитры
+        std::vector<std::shared_ptr<const svg::Style>> line_styles_;
+        std::vector<std::shared_ptr<const svg::Style>> bus_label_styles_;
+        std::shared_ptr<const svg::Style> underlayer_style_;
+        std::shared_ptr<const svg::Style> stop_style_;
+        std::shared_ptr<const svg::Style> stop_label_style_;
+
+        mutable std::mutex cache_mutex_;
+        mutable std::shared_ptr<const Layout> layout_;
+        // Плитки от недавно использованной к давно использованной
+        mutable TileCache tiles_;
+        mutable std::unordered_map<TileKey, TileCache::iterator, TileKeyHasher> tile_index_;
+        mutable TileCacheCounters tile_cache_counters_;
     };
-    
+
 }
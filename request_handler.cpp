@@ -11,7 +11,7 @@
 using namespace transport;
 
 
-RequestHandler::RequestHandler(const TransportCatalogue& db, const renderer::MapRenderer& renderer) : db_(db), renderer_(renderer) {
+RequestHandler::RequestHandler(const FrozenCatalogue& db, const renderer::MapRenderer& renderer) : db_(db), renderer_(renderer) {
     //
 }
 
@@ -20,10 +20,10 @@ std::optional<RouteStatistics> RequestHandler::GetBusStat(const std::string_view
     return db_.GetStat(bus);    
 }
 
-const std::set<BusPtr>* RequestHandler::GetBusesByStop(const std::string_view& stop_name) const {
+std::optional<std::span<const std::string_view>> RequestHandler::GetBusesByStop(const std::string_view& stop_name) const {
     return db_.GetBusses4Stop(stop_name);    
 }
 
-const svg::Document RequestHandler::RenderMap() const {
-    return renderer_.GetDocument();
+void RequestHandler::RenderMap(std::ostream& out) const {
+    renderer_.RenderMap(db_, out);
 }
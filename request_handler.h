@@ -20,20 +20,19 @@
 
 class RequestHandler {
 public:
-    // MapRenderer понадобится в следующей части итогового проекта
-    RequestHandler(const transport::TransportCatalogue& db, const renderer::MapRenderer& renderer);
+    RequestHandler(const transport::FrozenCatalogue& db, const renderer::MapRenderer& renderer);
 
     // Возвращает информацию о маршруте (запрос Bus)
     std::optional<transport::RouteStatistics> GetBusStat(const std::string_view& bus_name) const;
 
     // Возвращает маршруты, проходящие через
-    const std::set<transport::BusPtr>* GetBusesByStop(const std::string_view& stop_name) const;
+    std::optional<std::span<const std::string_view>> GetBusesByStop(const std::string_view& stop_name) const;
 
-    // Этот метод будет нужен в следующей части итогового проекта
-    const svg::Document RenderMap() const;
+    // Выводит карту маршрутов в формате SVG
+    void RenderMap(std::ostream& out) const;
 
 private:
     // RequestHandler использует агрегацию объектов "Транспортный Справочник" и "Визуализатор Карты"
-    const transport::TransportCatalogue& db_;
+    const transport::FrozenCatalogue& db_;
     const renderer::MapRenderer& renderer_;
 };
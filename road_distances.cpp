@@ -0,0 +1,80 @@
+#include "road_distances.h"
+
+using namespace transport;
+
+uint64_t RoadDistances::MakeKey(uint32_t from, uint32_t to) {
+    return static_cast<uint64_t>(from) << 32 | to;
+}
+
+// Мультипликативное хеширование: старшие биты произведения зависят от всех битов ключа
+size_t RoadDistances::GetSlot(uint64_t key) const {
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> shift_);
+}
+
+void RoadDistances::Add(uint32_t from, uint32_t to, int distance) {
+    Entry& forward = Insert(MakeKey(from, to));
+    forward.distance = distance;
+    forward.is_explicit = true;
+
+    Entry& backward = Insert(MakeKey(to, from));
+    if (!backward.is_explicit) {
+        backward.distance = distance;
+    }
+}
+
+std::optional<int> RoadDistances::Find(uint32_t from, uint32_t to) const {
+    if (entries_.empty()) {
+        return std::nullopt;
+    }
+    const uint64_t key = MakeKey(from, to);
+    const size_t mask = entries_.size() - 1;
+    for (size_t slot = GetSlot(key);; slot = (slot + 1) & mask) {
+        const Entry& entry = entries_[slot];
+        if (entry.key == key) {
+            return entry.distance;
+        }
+        if (entry.key == kEmpty) {
+            return std::nullopt;
+        }
+    }
+}
+
+size_t RoadDistances::GetSize() const {
+    return size_;
+}
+
+RoadDistances::Entry& RoadDistances::Insert(uint64_t key) {
+    // Заполненность таблицы не превышает половины, цепочки проб остаются короткими
+    if (2 * (size_ + 1) > entries_.size()) {
+        Grow();
+    }
+    const size_t mask = entries_.size() - 1;
+    size_t slot = GetSlot(key);
+    while (entries_[slot].key != key && entries_[slot].key != kEmpty) {
+        slot = (slot + 1) & mask;
+    }
+    Entry& entry = entries_[slot];
+    if (entry.key == kEmpty) {
+        entry.key = key;
+        ++size_;
+    }
+    return entry;
+}
+
+void RoadDistances::Grow() {
+    std::vector<Entry> old = std::move(entries_);
+    const size_t capacity = old.empty() ? 16 : old.size() * 2;
+    entries_.assign(capacity, Entry {});
+    shift_ = 64 - __builtin_ctzll(capacity);
+    const size_t mask = capacity - 1;
+    for (const Entry& entry : old) {
+        if (entry.key == kEmpty) {
+            continue;
+        }
+        size_t slot = GetSlot(entry.key);
+        while (entries_[slot].key != kEmpty) {
+            slot = (slot + 1) & mask;
+        }
+        entries_[slot] = entry;
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace transport {
+
+/*
+ * Расстояния по дорогам между парами остановок в одной таблице с открытой адресацией.
+ * Расстояние в обратную сторону, если оно не задано явно, записывается в таблицу
+ * при добавлении прямого, поэтому поиск всегда выполняется по одному ключу
+ */
+class RoadDistances {
+public:
+    void Add(uint32_t from, uint32_t to, int distance);
+    std::optional<int> Find(uint32_t from, uint32_t to) const;
+    size_t GetSize() const;
+
+private:
+    static constexpr uint64_t kEmpty = UINT64_MAX;
+
+    struct Entry {
+        uint64_t key = kEmpty;
+        int distance = 0;
+        // Расстояние задано для этого направления, а не взято из обратного
+        bool is_explicit = false;
+    };
+
+    static uint64_t MakeKey(uint32_t from, uint32_t to);
+    size_t GetSlot(uint64_t key) const;
+    Entry& Insert(uint64_t key);
+    void Grow();
+
+    std::vector<Entry> entries_;
+    size_t size_ = 0;
+    int shift_ = 64;
+};
+
+}  // namespace transport
@@ -0,0 +1,532 @@
+#include "router.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+using namespace graph;
+
+namespace {
+
+constexpr double kInfinity = std::numeric_limits<double>::infinity();
+// Поиск свидетеля останавливается после стольких вершин: лишнее сокращение не нарушает корректность
+constexpr size_t kWitnessSettleLimit = 50;
+// Сжатие останавливается, когда даже лучшая вершина добавляет больше сокращений, чем убирает рёбер,
+// на столько. Оставшиеся вершины образуют ядро
+constexpr double kCoreEdgeDifference = 2.0;
+
+using HierarchyEdge = Router::HierarchyEdge;
+
+// Ранг вершин ядра: они не сжимаются и равны между собой
+constexpr uint32_t kCoreRank = std::numeric_limits<uint32_t>::max();
+
+// Массив расстояний, который сбрасывается за O(1) сменой метки
+class DistanceMap {
+public:
+    explicit DistanceMap(size_t size)
+        : distances_(size, kInfinity)
+        , stamps_(size, 0) {
+    }
+
+    void Clear() {
+        if (++stamp_ == 0) {
+            std::fill(stamps_.begin(), stamps_.end(), 0);
+            stamp_ = 1;
+        }
+    }
+
+    double Get(VertexId v) const {
+        return stamps_[v] == stamp_ ? distances_[v] : kInfinity;
+    }
+
+    void Set(VertexId v, double distance) {
+        stamps_[v] = stamp_;
+        distances_[v] = distance;
+    }
+
+private:
+    std::vector<double> distances_;
+    std::vector<uint32_t> stamps_;
+    uint32_t stamp_ = 1;
+};
+
+using QueueItem = std::pair<double, VertexId>;
+using MinQueue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+
+// Куча поверх вектора: в отличие от priority_queue её память переживает очистку между поисками
+void PushHeap(std::vector<QueueItem>& heap, QueueItem item) {
+    heap.push_back(item);
+    std::push_heap(heap.begin(), heap.end(), std::greater<QueueItem> {});
+}
+
+QueueItem PopHeap(std::vector<QueueItem>& heap) {
+    std::pop_heap(heap.begin(), heap.end(), std::greater<QueueItem> {});
+    const QueueItem item = heap.back();
+    heap.pop_back();
+    return item;
+}
+
+/*
+ * Сжатие вершин. Порядок выбирается жадно по разности рёбер: сколько сокращений придётся добавить
+ * минус сколько рёбер исчезнет, плюс число уже удалённых соседей для равномерности.
+ * Приоритеты пересчитываются лениво при извлечении вершины из очереди
+ */
+class Contractor {
+public:
+    Contractor(size_t vertex_count, std::vector<HierarchyEdge>& edges)
+        : edges_(edges)
+        , out_(vertex_count)
+        , in_(vertex_count)
+        , contracted_(vertex_count, false)
+        , changed_(vertex_count, false)
+        , deleted_neighbors_(vertex_count, 0)
+        , witness_(vertex_count) {
+        for (uint32_t e = 0; e < edges_.size(); ++e) {
+            out_[edges_[e].from].push_back({edges_[e].to, e});
+            in_[edges_[e].to].push_back({edges_[e].from, e});
+        }
+    }
+
+    std::vector<uint32_t> Contract() {
+        const size_t vertex_count = out_.size();
+        MinQueue queue;
+        for (VertexId v = 0; v < vertex_count; ++v) {
+            queue.push({Priority(v), v});
+        }
+        std::vector<uint32_t> rank(vertex_count);
+        uint32_t next_rank = 0;
+        while (!queue.empty()) {
+            auto [priority, v] = queue.top();
+            queue.pop();
+            // Приоритет меняется, только когда сжимается соседняя вершина
+            if (changed_[v]) {
+                priority = Priority(v);
+                changed_[v] = false;
+            }
+            if (!queue.empty() && priority > queue.top().first) {
+                queue.push({priority, v});
+                continue;
+            }
+            if (priority > kCoreEdgeDifference) {
+                break;
+            }
+            ContractVertex(v, true);
+            rank[v] = next_rank++;
+        }
+        for (VertexId v = 0; v < vertex_count; ++v) {
+            if (!contracted_[v]) {
+                rank[v] = kCoreRank;
+            }
+        }
+        return rank;
+    }
+
+private:
+    struct Arc {
+        VertexId other;
+        uint32_t edge;
+    };
+
+    double Priority(VertexId v) {
+        const int shortcuts = ContractVertex(v, false);
+        const int removed = static_cast<int>(in_[v].size() + out_[v].size());
+        return shortcuts - removed + static_cast<double>(deleted_neighbors_[v]);
+    }
+
+    // Возвращает число нужных сокращений. При apply добавляет их и удаляет вершину из графа
+    int ContractVertex(VertexId v, bool apply) {
+        int shortcuts = 0;
+        for (const Arc in : in_[v]) {
+            const VertexId u = in.other;
+            const double to_v = edges_[in.edge].weight;
+            double limit = -1.0;
+            for (const Arc out : out_[v]) {
+                if (out.other != u) {
+                    limit = std::max(limit, to_v + edges_[out.edge].weight);
+                }
+            }
+            if (limit < 0.0) {
+                continue;
+            }
+            // Часто свидетелем служит прямое ребро, и поиск не нужен.
+            // Для оценки приоритета достаточно прямых рёбер
+            if (!WitnessedDirectly(u, v, to_v) && apply) {
+                FindWitnesses(u, v, limit);
+            }
+            for (const Arc out : out_[v]) {
+                const VertexId x = out.other;
+                const double via = to_v + edges_[out.edge].weight;
+                if (x == u || witness_.Get(x) <= via) {
+                    continue;
+                }
+                ++shortcuts;
+                if (apply) {
+                    AddShortcut(u, x, via, in.edge, out.edge);
+                }
+            }
+        }
+        if (apply) {
+            Remove(v);
+        }
+        return shortcuts;
+    }
+
+    // Заполняет witness_ рёбрами из source. Возвращает true, если их хватает для всех путей через vertex
+    bool WitnessedDirectly(VertexId source, VertexId vertex, double to_vertex) {
+        witness_.Clear();
+        for (const Arc out : out_[source]) {
+            if (out.other != vertex) {
+                witness_.Set(out.other, std::min(witness_.Get(out.other), edges_[out.edge].weight));
+            }
+        }
+        return std::all_of(out_[vertex].begin(), out_[vertex].end(), [&](const Arc out) {
+            return out.other == source || witness_.Get(out.other) <= to_vertex + edges_[out.edge].weight;
+        });
+    }
+
+    // Кратчайшие расстояния от source, не проходящие через vertex, не дальше limit
+    void FindWitnesses(VertexId source, VertexId vertex, double limit) {
+        witness_.Clear();
+        witness_.Set(source, 0.0);
+        queue_.clear();
+        PushHeap(queue_, {0.0, source});
+        size_t settled = 0;
+        while (!queue_.empty() && settled < kWitnessSettleLimit) {
+            const auto [distance, u] = PopHeap(queue_);
+            if (distance > witness_.Get(u)) {
+                continue;
+            }
+            if (distance > limit) {
+                break;
+            }
+            ++settled;
+            for (const Arc out : out_[u]) {
+                if (out.other == vertex) {
+                    continue;
+                }
+                const double candidate = distance + edges_[out.edge].weight;
+                if (candidate < witness_.Get(out.other)) {
+                    witness_.Set(out.other, candidate);
+                    PushHeap(queue_, {candidate, out.other});
+                }
+            }
+        }
+    }
+
+    void AddShortcut(VertexId from, VertexId to, double weight, uint32_t first, uint32_t second) {
+        const auto edge = static_cast<uint32_t>(edges_.size());
+        edges_.push_back({from, to, weight, Router::kNoEdge, first, second});
+        // Более длинное параллельное ребро заменяется сокращением
+        auto& out = out_[from];
+        auto out_it = std::find_if(out.begin(), out.end(), [to](const Arc& arc) {
+            return arc.other == to;
+        });
+        if (out_it != out.end()) {
+            out_it->edge = edge;
+            auto& in = in_[to];
+            std::find_if(in.begin(), in.end(), [from](const Arc& arc) {
+                return arc.other == from;
+            })->edge = edge;
+        } else {
+            out.push_back({to, edge});
+            in_[to].push_back({from, edge});
+        }
+    }
+
+    void Remove(VertexId v) {
+        contracted_[v] = true;
+        auto erase_arcs = [v](std::vector<Arc>& arcs) {
+            arcs.erase(std::remove_if(arcs.begin(), arcs.end(), [v](const Arc& arc) {
+                return arc.other == v;
+            }), arcs.end());
+        };
+        for (const Arc in : in_[v]) {
+            erase_arcs(out_[in.other]);
+            ++deleted_neighbors_[in.other];
+            changed_[in.other] = true;
+        }
+        for (const Arc out : out_[v]) {
+            erase_arcs(in_[out.other]);
+            ++deleted_neighbors_[out.other];
+            changed_[out.other] = true;
+        }
+        out_[v] = {};
+        in_[v] = {};
+    }
+
+    std::vector<HierarchyEdge>& edges_;
+    // Рёбра между ещё не удалёнными вершинами
+    std::vector<std::vector<Arc>> out_;
+    std::vector<std::vector<Arc>> in_;
+    std::vector<bool> contracted_;
+    std::vector<bool> changed_;
+    std::vector<uint32_t> deleted_neighbors_;
+    DistanceMap witness_;
+    std::vector<QueueItem> queue_;
+};
+
+// Раскладывает рёбра по вершинам в плоский массив
+void BuildAdjacency(size_t vertex_count, const std::vector<Router::SearchEdge>& edges,
+                    const std::vector<VertexId>& owners, std::vector<uint32_t>& offsets,
+                    std::vector<Router::SearchEdge>& sorted) {
+    offsets.assign(vertex_count + 1, 0);
+    for (const VertexId owner : owners) {
+        ++offsets[owner + 1];
+    }
+    for (size_t v = 0; v < vertex_count; ++v) {
+        offsets[v + 1] += offsets[v];
+    }
+    sorted.resize(edges.size());
+    std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < edges.size(); ++i) {
+        sorted[next[owners[i]]++] = edges[i];
+    }
+}
+
+}
+
+struct Router::Workspace {
+    explicit Workspace(size_t vertex_count)
+        : forward(vertex_count)
+        , backward(vertex_count)
+        , forward_parent(vertex_count)
+        , backward_parent(vertex_count) {
+    }
+
+    DistanceMap forward;
+    DistanceMap backward;
+    // Ребро иерархии, по которому вершина достигнута
+    std::vector<uint32_t> forward_parent;
+    std::vector<uint32_t> backward_parent;
+    std::vector<QueueItem> queue;
+    // Вершины ядра, достигнутые поиском вверх, затем очереди поиска в ядре
+    std::vector<QueueItem> forward_entries;
+    std::vector<QueueItem> backward_entries;
+    std::vector<uint32_t> path;
+};
+
+DirectedWeightedGraph::DirectedWeightedGraph(size_t vertex_count)
+    : vertex_count_(vertex_count) {
+}
+
+EdgeId DirectedWeightedGraph::AddEdge(const Edge& edge) {
+    if (edge.from >= vertex_count_ || edge.to >= vertex_count_ || !(edge.weight >= 0.0)) {
+        throw std::invalid_argument("invalid graph edge");
+    }
+    edges_.push_back(edge);
+    return static_cast<EdgeId>(edges_.size() - 1);
+}
+
+size_t DirectedWeightedGraph::GetVertexCount() const {
+    return vertex_count_;
+}
+
+size_t DirectedWeightedGraph::GetEdgeCount() const {
+    return edges_.size();
+}
+
+const Edge& DirectedWeightedGraph::GetEdge(EdgeId id) const {
+    return edges_.at(id);
+}
+
+Router::Router(const DirectedWeightedGraph& graph)
+    : vertex_count_(graph.GetVertexCount()) {
+    // Из параллельных рёбер нужно только самое короткое, петли не нужны
+    std::vector<EdgeId> order(graph.GetEdgeCount());
+    for (EdgeId e = 0; e < order.size(); ++e) {
+        order[e] = e;
+    }
+    std::sort(order.begin(), order.end(), [&graph](EdgeId lhs, EdgeId rhs) {
+        const Edge& l = graph.GetEdge(lhs);
+        const Edge& r = graph.GetEdge(rhs);
+        return std::tie(l.from, l.to, l.weight, lhs) < std::tie(r.from, r.to, r.weight, rhs);
+    });
+    for (size_t i = 0; i < order.size(); ++i) {
+        const Edge& edge = graph.GetEdge(order[i]);
+        const bool duplicate = !edges_.empty() && edges_.back().from == edge.from && edges_.back().to == edge.to;
+        if (edge.from != edge.to && !duplicate) {
+            edges_.push_back({edge.from, edge.to, edge.weight, order[i]});
+        }
+    }
+
+    const auto rank = Contractor(vertex_count_, edges_).Contract();
+
+    // Ребро попадает в поиск из менее важной вершины: прямой поиск идёт по нему вперёд, обратный - назад.
+    // Рёбра между вершинами ядра используются обоими поисками
+    core_.resize(vertex_count_);
+    for (VertexId v = 0; v < vertex_count_; ++v) {
+        core_[v] = rank[v] == kCoreRank;
+    }
+    std::vector<SearchEdge> up;
+    std::vector<VertexId> up_owners;
+    std::vector<SearchEdge> down;
+    std::vector<VertexId> down_owners;
+    for (uint32_t e = 0; e < edges_.size(); ++e) {
+        const HierarchyEdge& edge = edges_[e];
+        if (rank[edge.from] <= rank[edge.to]) {
+            up.push_back({edge.to, e, edge.weight});
+            up_owners.push_back(edge.from);
+        }
+        if (rank[edge.from] >= rank[edge.to]) {
+            down.push_back({edge.from, e, edge.weight});
+            down_owners.push_back(edge.to);
+        }
+    }
+    BuildAdjacency(vertex_count_, up, up_owners, up_offsets_, up_edges_);
+    BuildAdjacency(vertex_count_, down, down_owners, down_offsets_, down_edges_);
+}
+
+Router::~Router() = default;
+
+size_t Router::GetHierarchyEdgeCount() const {
+    return edges_.size();
+}
+
+std::unique_ptr<Router::Workspace> Router::AcquireWorkspace() const {
+    {
+        std::lock_guard guard(workspaces_mutex_);
+        if (!workspaces_.empty()) {
+            auto workspace = std::move(workspaces_.back());
+            workspaces_.pop_back();
+            return workspace;
+        }
+    }
+    return std::make_unique<Workspace>(vertex_count_);
+}
+
+void Router::ReleaseWorkspace(std::unique_ptr<Workspace> workspace) const {
+    std::lock_guard guard(workspaces_mutex_);
+    workspaces_.push_back(std::move(workspace));
+}
+
+std::optional<RouteInfo> Router::BuildRoute(VertexId from, VertexId to) const {
+    if (from >= vertex_count_ || to >= vertex_count_) {
+        return std::nullopt;
+    }
+    if (from == to) {
+        return RouteInfo {};
+    }
+
+    auto workspace = AcquireWorkspace();
+    Workspace& ws = *workspace;
+    ws.forward.Clear();
+    ws.backward.Clear();
+    ws.forward_entries.clear();
+    ws.backward_entries.clear();
+    ws.forward.Set(from, 0.0);
+    ws.backward.Set(to, 0.0);
+    ws.forward_parent[from] = kNoEdge;
+    ws.backward_parent[to] = kNoEdge;
+
+    double best = kInfinity;
+    VertexId meeting = from;
+    auto meet = [&best, &meeting](VertexId v, double total) {
+        if (total < best) {
+            best = total;
+            meeting = v;
+        }
+    };
+
+    // Поиск по рёбрам к более важным вершинам до вершин ядра. Он просматривает немного вершин,
+    // поэтому выполняется полностью, а достигнутые вершины ядра становятся началами поиска в ядре
+    auto search_up = [this, &ws, &meet](VertexId source, DistanceMap& own, const DistanceMap& other,
+                                        std::vector<uint32_t>& parent, const std::vector<uint32_t>& offsets,
+                                        const std::vector<SearchEdge>& edges, std::vector<QueueItem>& entries) {
+        auto& queue = ws.queue;
+        queue.clear();
+        PushHeap(queue, {0.0, source});
+        while (!queue.empty()) {
+            const auto [distance, v] = PopHeap(queue);
+            if (distance > own.Get(v)) {
+                continue;
+            }
+            meet(v, distance + other.Get(v));
+            if (core_[v]) {
+                entries.push_back({distance, v});
+                continue;
+            }
+            for (uint32_t i = offsets[v]; i < offsets[v + 1]; ++i) {
+                const SearchEdge& edge = edges[i];
+                const double candidate = distance + edge.weight;
+                if (candidate < own.Get(edge.to)) {
+                    own.Set(edge.to, candidate);
+                    parent[edge.to] = edge.edge;
+                    PushHeap(queue, {candidate, edge.to});
+                }
+            }
+        }
+        std::make_heap(entries.begin(), entries.end(), std::greater<QueueItem> {});
+    };
+    search_up(from, ws.forward, ws.backward, ws.forward_parent, up_offsets_, up_edges_, ws.forward_entries);
+    search_up(to, ws.backward, ws.forward, ws.backward_parent, down_offsets_, down_edges_, ws.backward_entries);
+
+    // В ядре обычный двунаправленный поиск Дейкстры: он заканчивается, когда сумма расстояний
+    // на вершинах очередей не меньше лучшего пути
+    auto step = [&meet](std::vector<QueueItem>& queue, DistanceMap& own, const DistanceMap& other,
+                        std::vector<uint32_t>& parent, const std::vector<uint32_t>& offsets,
+                        const std::vector<SearchEdge>& edges) {
+        const auto [distance, v] = PopHeap(queue);
+        if (distance > own.Get(v)) {
+            return;
+        }
+        for (uint32_t i = offsets[v]; i < offsets[v + 1]; ++i) {
+            const SearchEdge& edge = edges[i];
+            const double candidate = distance + edge.weight;
+            if (candidate < own.Get(edge.to)) {
+                own.Set(edge.to, candidate);
+                parent[edge.to] = edge.edge;
+                PushHeap(queue, {candidate, edge.to});
+                meet(edge.to, candidate + other.Get(edge.to));
+            }
+        }
+    };
+    auto& forward_queue = ws.forward_entries;
+    auto& backward_queue = ws.backward_entries;
+    while (!forward_queue.empty() && !backward_queue.empty()
+           && forward_queue.front().first + backward_queue.front().first < best) {
+        if (forward_queue.size() <= backward_queue.size()) {
+            step(forward_queue, ws.forward, ws.backward, ws.forward_parent, up_offsets_, up_edges_);
+        } else {
+            step(backward_queue, ws.backward, ws.forward, ws.backward_parent, down_offsets_, down_edges_);
+        }
+    }
+
+    std::optional<RouteInfo> result;
+    if (best < kInfinity) {
+        result.emplace();
+        result->weight = best;
+        // Рёбра иерархии от начала до точки встречи и от неё до конца
+        auto& path = ws.path;
+        path.clear();
+        for (VertexId v = meeting; v != from;) {
+            const uint32_t edge = ws.forward_parent[v];
+            path.push_back(edge);
+            v = edges_[edge].from;
+        }
+        std::reverse(path.begin(), path.end());
+        for (VertexId v = meeting; v != to;) {
+            const uint32_t edge = ws.backward_parent[v];
+            path.push_back(edge);
+            v = edges_[edge].to;
+        }
+        for (const uint32_t edge : path) {
+            Unpack(edge, result->edges);
+        }
+    }
+    ReleaseWorkspace(std::move(workspace));
+    return result;
+}
+
+void Router::Unpack(uint32_t edge, std::vector<EdgeId>& edges) const {
+    const HierarchyEdge& hierarchy_edge = edges_[edge];
+    if (hierarchy_edge.original != kNoEdge) {
+        edges.push_back(hierarchy_edge.original);
+        return;
+    }
+    Unpack(hierarchy_edge.first, edges);
+    Unpack(hierarchy_edge.second, edges);
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+/*
+ * Кратчайшие пути в ориентированном взвешенном графе.
+ * Граф один раз предобрабатывается сжатием вершин (contraction hierarchies): вершины
+ * удаляются по одной от менее важных к более важным, а кратчайшие пути через удаляемую
+ * вершину сохраняются рёбрами-сокращениями. Сжатие останавливается, когда вершины начинают
+ * добавлять больше сокращений, чем убирают рёбер: в сетях без выраженной иерархии (пересадочные
+ * остановки случайной сети маршрутов) оставшееся ядро сжимать дорого.
+ * Запрос ищет от начала и от конца только по рёбрам к более важным вершинам до ядра,
+ * затем в ядре выполняется обычный двунаправленный поиск Дейкстры.
+ * Найденные сокращения разворачиваются обратно в рёбра исходного графа
+ */
+
+namespace graph {
+
+using VertexId = uint32_t;
+using EdgeId = uint32_t;
+
+struct Edge {
+    VertexId from;
+    VertexId to;
+    double weight;
+};
+
+class DirectedWeightedGraph {
+public:
+    explicit DirectedWeightedGraph(size_t vertex_count);
+
+    EdgeId AddEdge(const Edge& edge);
+
+    size_t GetVertexCount() const;
+    size_t GetEdgeCount() const;
+    const Edge& GetEdge(EdgeId id) const;
+
+private:
+    size_t vertex_count_;
+    std::vector<Edge> edges_;
+};
+
+struct RouteInfo {
+    double weight = 0.0;
+    // Рёбра исходного графа по порядку следования
+    std::vector<EdgeId> edges;
+};
+
+class Router {
+public:
+    // Предобработка графа. Граф после построения маршрутизатора не нужен
+    explicit Router(const DirectedWeightedGraph& graph);
+    ~Router();
+
+    // Может вызываться из нескольких потоков одновременно
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    // Число рёбер иерархии: рёбра исходного графа без параллельных и добавленные сокращения
+    size_t GetHierarchyEdgeCount() const;
+
+    static constexpr uint32_t kNoEdge = UINT32_MAX;
+
+    // Ребро иерархии: ребро исходного графа либо сокращение пути из двух рёбер иерархии
+    struct HierarchyEdge {
+        VertexId from;
+        VertexId to;
+        double weight;
+        EdgeId original = kNoEdge;
+        uint32_t first = kNoEdge;
+        uint32_t second = kNoEdge;
+    };
+
+    // Ребро поиска: сосед более высокого ранга и номер ребра иерархии
+    struct SearchEdge {
+        VertexId to;
+        uint32_t edge;
+        double weight;
+    };
+
+private:
+    struct Workspace;
+
+    std::unique_ptr<Workspace> AcquireWorkspace() const;
+    void ReleaseWorkspace(std::unique_ptr<Workspace> workspace) const;
+    void Unpack(uint32_t edge, std::vector<EdgeId>& edges) const;
+
+    size_t vertex_count_;
+    std::vector<HierarchyEdge> edges_;
+    // Рёбра из вершины в более важные вершины: up_edges_[up_offsets_[v], up_offsets_[v + 1])
+    std::vector<uint32_t> up_offsets_;
+    std::vector<SearchEdge> up_edges_;
+    // Рёбра в вершину из более важных вершин, хранятся развёрнутыми
+    std::vector<uint32_t> down_offsets_;
+    std::vector<SearchEdge> down_edges_;
+    // Вершины, оставшиеся несжатыми
+    std::vector<bool> core_;
+
+    // Рабочие массивы поиска переиспользуются запросами, чтобы не заполнять их заново
+    mutable std::mutex workspaces_mutex_;
+    mutable std::vector<std::unique_ptr<Workspace>> workspaces_;
+};
+
+}  // namespace graph
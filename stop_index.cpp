@@ -0,0 +1,262 @@
+#define _USE_MATH_DEFINES
+#include "stop_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <utility>
+
+using namespace transport;
+
+namespace {
+
+// Точек в листе: перебор небольшого листа дешевле ещё одного уровня дерева
+constexpr uint32_t kLeafSize = 8;
+
+void ToUnitVector(geo::Coordinates place, double (&xyz)[3]) {
+    const double lat = place.lat * M_PI / 180.0;
+    const double lng = place.lng * M_PI / 180.0;
+    xyz[0] = std::cos(lat) * std::cos(lng);
+    xyz[1] = std::cos(lat) * std::sin(lng);
+    xyz[2] = std::sin(lat);
+}
+
+double SquaredChord(const double (&lhs)[3], const double (&rhs)[3]) {
+    double sum = 0.0;
+    for (int axis = 0; axis < 3; ++axis) {
+        const double delta = lhs[axis] - rhs[axis];
+        sum += delta * delta;
+    }
+    return sum;
+}
+
+// Хорда единичной сферы в расстояние вдоль поверхности Земли
+double ChordToMeters(double squared_chord) {
+    const double half_chord = std::min(1.0, std::sqrt(squared_chord) / 2.0);
+    return 2.0 * std::asin(half_chord) * geo::EarthRadius;
+}
+
+template <typename Node>
+double SquaredChordToBox(const double (&xyz)[3], const Node& node) {
+    double sum = 0.0;
+    for (int axis = 0; axis < 3; ++axis) {
+        const double delta = std::max({node.min_xyz[axis] - xyz[axis], xyz[axis] - node.max_xyz[axis], 0.0});
+        sum += delta * delta;
+    }
+    return sum;
+}
+
+void SortByDistance(std::vector<std::pair<double, uint32_t>>& found, std::vector<NearbyStop>& result) {
+    std::sort(found.begin(), found.end());
+    result.reserve(found.size());
+    for (const auto& [squared_chord, stop] : found) {
+        result.push_back({stop, ChordToMeters(squared_chord)});
+    }
+}
+
+}
+
+StopIndex::StopIndex(std::span<const geo::Coordinates> places) {
+    if (places.empty()) {
+        return;
+    }
+    points_.reserve(places.size());
+    for (uint32_t stop = 0; stop < places.size(); ++stop) {
+        Point& point = points_.emplace_back();
+        ToUnitVector(places[stop], point.xyz);
+        point.lat = places[stop].lat;
+        point.lng = places[stop].lng;
+        point.stop = stop;
+    }
+    nodes_.reserve(2 * (places.size() / kLeafSize + 1));
+    Build(0, static_cast<uint32_t>(points_.size()));
+}
+
+uint32_t StopIndex::Build(uint32_t begin, uint32_t end) {
+    const auto index = static_cast<uint32_t>(nodes_.size());
+    Node& node = nodes_.emplace_back();
+    node.begin = begin;
+    node.end = end;
+    if (end - begin <= kLeafSize) {
+        for (int axis = 0; axis < 3; ++axis) {
+            node.min_xyz[axis] = std::numeric_limits<double>::infinity();
+            node.max_xyz[axis] = -std::numeric_limits<double>::infinity();
+        }
+        node.min_lat = node.min_lng = std::numeric_limits<double>::infinity();
+        node.max_lat = node.max_lng = -std::numeric_limits<double>::infinity();
+        for (uint32_t i = begin; i < end; ++i) {
+            const Point& point = points_[i];
+            for (int axis = 0; axis < 3; ++axis) {
+                node.min_xyz[axis] = std::min(node.min_xyz[axis], point.xyz[axis]);
+                node.max_xyz[axis] = std::max(node.max_xyz[axis], point.xyz[axis]);
+            }
+            node.min_lat = std::min(node.min_lat, point.lat);
+            node.max_lat = std::max(node.max_lat, point.lat);
+            node.min_lng = std::min(node.min_lng, point.lng);
+            node.max_lng = std::max(node.max_lng, point.lng);
+        }
+        return index;
+    }
+
+    // Точки делятся пополам по оси наибольшего разброса
+    double min_xyz[3] = {1.0, 1.0, 1.0};
+    double max_xyz[3] = {-1.0, -1.0, -1.0};
+    for (uint32_t i = begin; i < end; ++i) {
+        for (int axis = 0; axis < 3; ++axis) {
+            min_xyz[axis] = std::min(min_xyz[axis], points_[i].xyz[axis]);
+            max_xyz[axis] = std::max(max_xyz[axis], points_[i].xyz[axis]);
+        }
+    }
+    int split_axis = 0;
+    for (int axis = 1; axis < 3; ++axis) {
+        if (max_xyz[axis] - min_xyz[axis] > max_xyz[split_axis] - min_xyz[split_axis]) {
+            split_axis = axis;
+        }
+    }
+    const uint32_t middle = begin + (end - begin) / 2;
+    std::nth_element(points_.begin() + begin, points_.begin() + middle, points_.begin() + end,
+                     [split_axis](const Point& lhs, const Point& rhs) {
+                         return lhs.xyz[split_axis] < rhs.xyz[split_axis];
+                     });
+    const uint32_t left = Build(begin, middle);
+    const uint32_t right = Build(middle, end);
+
+    // Границы узла объединяют границы детей. Ссылка на узел могла устареть при добавлении детей
+    Node& built = nodes_[index];
+    const Node& lhs = nodes_[left];
+    const Node& rhs = nodes_[right];
+    built.left = left;
+    built.right = right;
+    for (int axis = 0; axis < 3; ++axis) {
+        built.min_xyz[axis] = std::min(lhs.min_xyz[axis], rhs.min_xyz[axis]);
+        built.max_xyz[axis] = std::max(lhs.max_xyz[axis], rhs.max_xyz[axis]);
+    }
+    built.min_lat = std::min(lhs.min_lat, rhs.min_lat);
+    built.max_lat = std::max(lhs.max_lat, rhs.max_lat);
+    built.min_lng = std::min(lhs.min_lng, rhs.min_lng);
+    built.max_lng = std::max(lhs.max_lng, rhs.max_lng);
+    return index;
+}
+
+std::vector<NearbyStop> StopIndex::FindNearest(geo::Coordinates point, size_t count) const {
+    std::vector<NearbyStop> result;
+    if (count == 0 || nodes_.empty()) {
+        return result;
+    }
+    double xyz[3];
+    ToUnitVector(point, xyz);
+
+    // Узлы просматриваются по возрастанию расстояния до их границ, пока оно меньше худшего найденного
+    using Item = std::pair<double, uint32_t>;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> nodes;
+    std::priority_queue<Item> found;
+    nodes.push({0.0, 0});
+    while (!nodes.empty()) {
+        const auto [node_distance, index] = nodes.top();
+        nodes.pop();
+        if (found.size() == count && node_distance > found.top().first) {
+            break;
+        }
+        const Node& node = nodes_[index];
+        if (node.left == 0) {
+            for (uint32_t i = node.begin; i < node.end; ++i) {
+                const Item candidate {SquaredChord(xyz, points_[i].xyz), points_[i].stop};
+                if (found.size() < count) {
+                    found.push(candidate);
+                } else if (candidate < found.top()) {
+                    found.pop();
+                    found.push(candidate);
+                }
+            }
+            continue;
+        }
+        for (const uint32_t child : {node.left, node.right}) {
+            nodes.push({SquaredChordToBox(xyz, nodes_[child]), child});
+        }
+    }
+
+    std::vector<Item> nearest;
+    nearest.reserve(found.size());
+    while (!found.empty()) {
+        nearest.push_back(found.top());
+        found.pop();
+    }
+    SortByDistance(nearest, result);
+    return result;
+}
+
+std::vector<NearbyStop> StopIndex::FindInRadius(geo::Coordinates point, double radius) const {
+    std::vector<NearbyStop> result;
+    if (nodes_.empty() || !(radius >= 0.0)) {
+        return result;
+    }
+    double xyz[3];
+    ToUnitVector(point, xyz);
+    // Радиус больше половины окружности Земли покрывает все остановки
+    const double angle = std::min(radius / geo::EarthRadius, M_PI);
+    const double chord = 2.0 * std::sin(angle / 2.0);
+    const double max_squared_chord = chord * chord;
+
+    std::vector<std::pair<double, uint32_t>> found;
+    std::vector<uint32_t> stack {0};
+    while (!stack.empty()) {
+        const Node& node = nodes_[stack.back()];
+        stack.pop_back();
+        if (SquaredChordToBox(xyz, node) > max_squared_chord) {
+            continue;
+        }
+        if (node.left != 0) {
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+            continue;
+        }
+        for (uint32_t i = node.begin; i < node.end; ++i) {
+            if (const double squared_chord = SquaredChord(xyz, points_[i].xyz); squared_chord <= max_squared_chord) {
+                found.push_back({squared_chord, points_[i].stop});
+            }
+        }
+    }
+    SortByDistance(found, result);
+    return result;
+}
+
+template <typename Visit>
+void StopIndex::VisitInBox(uint32_t index, double min_lat, double max_lat, double min_lng, double max_lng,
+                           Visit& visit) const {
+    const Node& node = nodes_[index];
+    if (node.max_lat < min_lat || node.min_lat > max_lat || node.max_lng < min_lng || node.min_lng > max_lng) {
+        return;
+    }
+    const bool inside = node.min_lat >= min_lat && node.max_lat <= max_lat
+        && node.min_lng >= min_lng && node.max_lng <= max_lng;
+    if (inside || node.left == 0) {
+        for (uint32_t i = node.begin; i < node.end; ++i) {
+            const Point& point = points_[i];
+            if (inside || (point.lat >= min_lat && point.lat <= max_lat && point.lng >= min_lng && point.lng <= max_lng)) {
+                visit(point.stop);
+            }
+        }
+        return;
+    }
+    VisitInBox(node.left, min_lat, max_lat, min_lng, max_lng, visit);
+    VisitInBox(node.right, min_lat, max_lat, min_lng, max_lng, visit);
+}
+
+std::vector<uint32_t> StopIndex::FindInBox(geo::Coordinates min, geo::Coordinates max) const {
+    std::vector<uint32_t> result;
+    if (nodes_.empty() || min.lat > max.lat) {
+        return result;
+    }
+    auto visit = [&result](uint32_t stop) {
+        result.push_back(stop);
+    };
+    if (min.lng <= max.lng) {
+        VisitInBox(0, min.lat, max.lat, min.lng, max.lng, visit);
+    } else {
+        VisitInBox(0, min.lat, max.lat, min.lng, 180.0, visit);
+        VisitInBox(0, min.lat, max.lat, -180.0, max.lng, visit);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
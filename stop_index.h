@@ -0,0 +1,72 @@
+#pragma once
+
+#include "geo.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/*
+ * Пространственный индекс остановок: k-d дерево над точками единичной сферы.
+ * Координаты переводятся в трёхмерные единичные векторы, в которых расстояние по хорде
+ * монотонно по расстоянию вдоль поверхности Земли, поэтому поиск ближайших и поиск в радиусе
+ * отсекают поддеревья по прямоугольным границам без особых случаев у полюсов и 180-го меридиана.
+ * Каждый узел дополнительно хранит границы широт и долгот своих точек для поиска в прямоугольнике.
+ * Точки листьев лежат подряд, узел поддерева адресует непрерывный диапазон точек
+ */
+
+namespace transport {
+
+struct NearbyStop {
+    uint32_t stop;
+    // Расстояние вдоль поверхности Земли в метрах
+    double distance;
+};
+
+class StopIndex {
+public:
+    StopIndex() = default;
+    // Номер остановки - её позиция в places
+    explicit StopIndex(std::span<const geo::Coordinates> places);
+
+    // Не больше count ближайших к point остановок по возрастанию расстояния
+    std::vector<NearbyStop> FindNearest(geo::Coordinates point, size_t count) const;
+    // Остановки не дальше radius метров от point по возрастанию расстояния
+    std::vector<NearbyStop> FindInRadius(geo::Coordinates point, double radius) const;
+    // Остановки, широта и долгота которых лежат в границах min и max, по возрастанию номера.
+    // Если min.lng > max.lng, прямоугольник пересекает 180-й меридиан
+    std::vector<uint32_t> FindInBox(geo::Coordinates min, geo::Coordinates max) const;
+
+private:
+    struct Point {
+        double xyz[3];
+        double lat;
+        double lng;
+        uint32_t stop;
+    };
+
+    struct Node {
+        double min_xyz[3];
+        double max_xyz[3];
+        double min_lat;
+        double max_lat;
+        double min_lng;
+        double max_lng;
+        // Точки узла: points_[begin, end)
+        uint32_t begin;
+        uint32_t end;
+        // Номера дочерних узлов, у листа 0
+        uint32_t left = 0;
+        uint32_t right = 0;
+    };
+
+    uint32_t Build(uint32_t begin, uint32_t end);
+
+    template <typename Visit>
+    void VisitInBox(uint32_t node, double min_lat, double max_lat, double min_lng, double max_lng, Visit& visit) const;
+
+    std::vector<Point> points_;
+    std::vector<Node> nodes_;
+};
+
+}  // namespace transport
@@ -1,7 +1,11 @@
 #include "svg.h"
+#include "text_scan.h"
 
 #define _USE_MATH_DEFINES 
+#include <algorithm>
+#include <charconv>
 #include <cmath>
+#include <utility>
 
 using namespace std;
 
@@ -20,6 +24,78 @@ namespace {
     }
     return polyline.SetFillColor("red"s).SetStrokeColor("black"s);
 }
+
+std::string_view ToString(svg::StrokeLineCap cap) {
+    switch (cap) {
+        case svg::StrokeLineCap::BUTT : return "butt"sv;
+        case svg::StrokeLineCap::ROUND : return "round"sv;
+        case svg::StrokeLineCap::SQUARE : return "square"sv;
+    }
+    return {};
+}
+
+std::string_view ToString(svg::StrokeLineJoin join) {
+    switch (join) {
+        case svg::StrokeLineJoin::ARCS : return "arcs"sv;
+        case svg::StrokeLineJoin::BEVEL : return "bevel"sv;
+        case svg::StrokeLineJoin::MITER : return "miter"sv;
+        case svg::StrokeLineJoin::MITER_CLIP : return "miter-clip"sv;
+        case svg::StrokeLineJoin::ROUND : return "round"sv;
+    }
+    return {};
+}
+
+constexpr int64_t kPowersOf10[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+static_assert(std::size(kPowersOf10) == svg::RenderOptions::kMaxPrecision + 1);
+
+// Числа с фиксированной точностью выводятся как целое число единиц последнего знака.
+// Слишком большие значения так не представить
+bool ToUnits(double value, int precision, int64_t& units) {
+    const double scaled = value * static_cast<double>(kPowersOf10[precision]);
+    if (!(std::fabs(scaled) < 9e15)) {
+        return false;
+    }
+    units = std::llround(scaled);
+    return true;
+}
+
+// Выводит units / 10^precision без незначащих нулей дробной части
+void WriteUnits(std::string& out, int64_t units, int precision) {
+    if (units < 0) {
+        out.push_back('-');
+        units = -units;
+    }
+    char buffer[24];
+    const auto integral = std::to_chars(buffer, buffer + sizeof(buffer), units / kPowersOf10[precision]);
+    out.append(buffer, integral.ptr);
+    int64_t fraction = units % kPowersOf10[precision];
+    if (fraction == 0) {
+        return;
+    }
+    int digits = precision;
+    while (fraction % 10 == 0) {
+        fraction /= 10;
+        --digits;
+    }
+    out.push_back('.');
+    char* end = buffer + digits;
+    for (char* cur = end; cur != buffer; fraction /= 10) {
+        *--cur = static_cast<char>('0' + fraction % 10);
+    }
+    out.append(buffer, end);
+}
+
+// Если следующее число отрицательное, разделителем служит его знак
+void WriteSeparated(std::string& out, char separator, int64_t units, int precision) {
+    if (units >= 0) {
+        out.push_back(separator);
+    }
+    WriteUnits(out, units, precision);
+}
+
+// Блок, которым DocumentStream пишет в ostream
+constexpr size_t kFlushSize = 1 << 16;
+
 }
 
 namespace svg {
@@ -28,37 +104,173 @@ using namespace std::literals;
 using namespace shapes;
     
 std::ostream& operator << (std::ostream &os, const StrokeLineCap &cap) {
-    switch(cap) {
-        case StrokeLineCap::BUTT : return os << "butt"; 
-        case StrokeLineCap::ROUND : return os << "round";  
-        case StrokeLineCap::SQUARE : return os << "square";
-        default: return os;
-    }
-    return os;
+    return os << ToString(cap);
 }
     
-std::ostream& operator << (std::ostream &os, const StrokeLineJoin &join)
-{
-    switch(join) {
-        case StrokeLineJoin::ARCS : return os << "arcs"; 
-        case StrokeLineJoin::BEVEL : return os << "bevel";  
-        case StrokeLineJoin::MITER : return os << "miter";
-        case StrokeLineJoin::MITER_CLIP : return os << "miter-clip";  
-        case StrokeLineJoin::ROUND : return os << "round";
-            
-        default: return os;
+std::ostream& operator << (std::ostream &os, const StrokeLineJoin &join) {
+    return os << ToString(join);
+}
+
+// ---------- RenderContext ------------
+
+void RenderContext::WriteNumber(double value) const {
+    char buffer[32];
+    if (options.precision < 0) {
+        // Так же число выводит ostream с точностью по умолчанию
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, 6);
+        out.append(buffer, result.ptr);
+        return;
     }
-    return os;
+    const int precision = std::min(options.precision, RenderOptions::kMaxPrecision);
+    if (int64_t units; ToUnits(value, precision, units)) {
+        WriteUnits(out, units, precision);
+        return;
+    }
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+void RenderContext::WriteNumber(uint32_t value) const {
+    char buffer[16];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+void RenderContext::WriteEscaped(std::string_view text) const {
+    const char* cur = text.data();
+    const char* end = cur + text.size();
+    while (true) {
+        // Участки без спецсимволов выводятся целиком
+        const char* special = text_scan::FindXmlEscape(cur, end);
+        out.append(cur, special);
+        if (special == end) {
+            break;
+        }
+        const char ch = *special;
+        if (ch == '\"') {
+            out.append("&quot;"sv);
+        } else if (ch == '\'') {
+            out.append("&apos;"sv);
+        } else if (ch == '<') {
+            out.append("&lt;"sv);
+        } else if (ch == '>') {
+            out.append("&gt;"sv);
+        } else {
+            out.append("&amp;"sv);
+        }
+        cur = special + 1;
+    }
+}
+
+void RenderContext::WriteStyle(const Style& style) const {
+    if (styles) {
+        if (style != Style {}) {
+            Write(" class=\"s"sv);
+            WriteNumber(styles->Add(style));
+            Write('"');
+        }
+        return;
+    }
+    if (style.fill) {
+        Write(" fill=\""sv);
+        Write(*style.fill);
+        Write('"');
+    }
+    if (style.stroke) {
+        Write(" stroke=\""sv);
+        Write(*style.stroke);
+        Write('"');
+    }
+    if (style.stroke_width) {
+        Write(" stroke-width=\""sv);
+        WriteNumber(*style.stroke_width);
+        Write('"');
+    }
+    if (style.stroke_linecap) {
+        Write(" stroke-linecap=\""sv);
+        Write(ToString(*style.stroke_linecap));
+        Write('"');
+    }
+    if (style.stroke_linejoin) {
+        Write(" stroke-linejoin=\""sv);
+        Write(ToString(*style.stroke_linejoin));
+        Write('"');
+    }
+}
+
+// ---------- StyleTable ---------------
+
+size_t StyleHasher::operator()(const Style& style) const {
+    const std::hash<std::string_view> hash_string;
+    size_t hash = style.fill ? hash_string(*style.fill) : 0;
+    hash = hash * 37 + (style.stroke ? hash_string(*style.stroke) : 1);
+    hash = hash * 37 + (style.stroke_width ? std::hash<double>{}(*style.stroke_width) : 2);
+    hash = hash * 37 + (style.stroke_linecap ? static_cast<size_t>(*style.stroke_linecap) : 100);
+    hash = hash * 37 + (style.stroke_linejoin ? static_cast<size_t>(*style.stroke_linejoin) : 100);
+    return hash;
+}
+
+uint32_t StyleTable::Add(const Style& style) {
+    const auto [it, inserted] = ids_.emplace(style, static_cast<uint32_t>(styles_.size()));
+    if (inserted) {
+        styles_.push_back(style);
+    }
+    return it->second;
+}
+
+size_t StyleTable::GetSize() const {
+    return styles_.size();
+}
+
+void StyleTable::Render(const RenderContext& context) const {
+    context.Write("<style>"sv);
+    for (uint32_t id = 0; id < styles_.size(); ++id) {
+        const Style& style = styles_[id];
+        context.Write(".s"sv);
+        context.WriteNumber(id);
+        context.Write('{');
+        // Перед каждым свойством, кроме первого, ставится ;
+        bool first = true;
+        auto property = [&context, &first](std::string_view name) {
+            if (!first) {
+                context.Write(';');
+            }
+            first = false;
+            context.Write(name);
+            context.Write(':');
+        };
+        if (style.fill) {
+            property("fill"sv);
+            context.Write(*style.fill);
+        }
+        if (style.stroke) {
+            property("stroke"sv);
+            context.Write(*style.stroke);
+        }
+        if (style.stroke_width) {
+            property("stroke-width"sv);
+            context.WriteNumber(*style.stroke_width);
+        }
+        if (style.stroke_linecap) {
+            property("stroke-linecap"sv);
+            context.Write(ToString(*style.stroke_linecap));
+        }
+        if (style.stroke_linejoin) {
+            property("stroke-linejoin"sv);
+            context.Write(ToString(*style.stroke_linejoin));
+        }
+        context.Write('}');
+    }
+    context.Write("</style>"sv);
 }
 
-    
 void Object::Render(const RenderContext& context) const {
     context.RenderIndent();
 
     // Делегируем вывод тега своим подклассам
     RenderObject(context);
 
-    context.out << std::endl;
+    context.Write('\n');
 }
 
 // ---------- Circle ------------------
@@ -74,11 +286,15 @@ Circle& Circle::SetRadius(double radius)  {
 }
 
 void Circle::RenderObject(const RenderContext& context) const {
-    auto& out = context.out;
-    out << "<circle cx=\""sv << center_.x << "\" cy=\""sv << center_.y << "\" "sv;
-    out << "r=\""sv << radius_ << "\""sv;
-    PathProps::WriteProps(out);
-    out << "/>"sv;
+    context.Write("<circle cx=\""sv);
+    context.WriteNumber(center_.x);
+    context.Write("\" cy=\""sv);
+    context.WriteNumber(center_.y);
+    context.Write("\" r=\""sv);
+    context.WriteNumber(radius_);
+    context.Write('"');
+    PathProps::WriteProps(context);
+    context.Write("/>"sv);
 }
     
 // ----------Document-----------------
@@ -86,17 +302,132 @@ void Document::AddPtr(std::unique_ptr<Object>&& obj) {
     objects_.push_back(std::move(obj));
 }
     
-void Document::Render(std::ostream& out) const {
-    RenderContext context(out);
-    out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"sv << std::endl;
-    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">"sv << std::endl;
+void Document::Render(std::ostream& out, RenderOptions options) const {
+    std::string buffer;
+    Render(buffer, options);
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
+
+void Document::Render(std::string& out, RenderOptions options) const {
+    DocumentStream stream(out, options);
     for (const auto& obj : objects_) {
-        out << "  "sv;
-        obj->Render(context);
+        stream.Render(*obj);
+    }
+    stream.Close();
+}
+
+// ----------DocumentStream-----------
+
+DocumentStream::DocumentStream(std::ostream& out, RenderOptions options, std::optional<ViewBox> view_box)
+    : stream_(&out)
+    , context_(buffer_, options) {
+    buffer_.reserve(2 * kFlushSize);
+    WriteHeader(view_box);
+}
+
+DocumentStream::DocumentStream(std::string& out, RenderOptions options, std::optional<ViewBox> view_box)
+    : context_(out, options) {
+    WriteHeader(view_box);
+}
+
+void DocumentStream::WriteHeader(const std::optional<ViewBox>& view_box) {
+    if (context_.options.css_classes) {
+        context_.styles = &styles_;
+    }
+    context_.Write("<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"sv);
+    context_.Write("<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\""sv);
+    if (view_box) {
+        context_.Write(" viewBox=\""sv);
+        context_.WriteNumber(view_box->min.x);
+        context_.Write(' ');
+        context_.WriteNumber(view_box->min.y);
+        context_.Write(' ');
+        context_.WriteNumber(view_box->width);
+        context_.Write(' ');
+        context_.WriteNumber(view_box->height);
+        context_.Write('"');
+    }
+    context_.Write(">\n"sv);
+}
+
+void DocumentStream::FlushIfFull() {
+    if (stream_ && buffer_.size() >= kFlushSize) {
+        stream_->write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+}
+
+void DocumentStream::AddPtr(std::unique_ptr<Object>&& obj) {
+    Render(*obj);
+}
+
+void DocumentStream::Render(const Object& obj) {
+    context_.Write("  "sv);
+    obj.Render(context_);
+    FlushIfFull();
+}
+
+// Стили становятся известны по мере вывода элементов, поэтому таблица выводится в конце документа.
+// Правила CSS действуют на весь документ независимо от положения элемента <style>
+void DocumentStream::Close() {
+    if (styles_.GetSize() > 0) {
+        context_.Write("  "sv);
+        styles_.Render(context_);
+        context_.Write('\n');
+    }
+    context_.Write("</svg>\n"sv);
+    if (stream_) {
+        stream_->write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
     }
-    out << "</svg>"sv << std::endl;
 }
     
+// ----------Symbol-------------------
+
+Symbol::Symbol(std::string id)
+    : id_(std::move(id)) {
+}
+
+void Symbol::AddPtr(std::unique_ptr<Object>&& obj) {
+    objects_.push_back(std::move(obj));
+}
+
+void Symbol::RenderObject(const RenderContext& context) const {
+    // Вложенные объекты могут выходить за границы шаблона
+    context.Write("<symbol id=\""sv);
+    context.WriteEscaped(id_);
+    context.Write("\" overflow=\"visible\">\n"sv);
+    RenderContext inner = context;
+    inner.indent += 4;
+    for (const auto& obj : objects_) {
+        obj->Render(inner);
+    }
+    context.RenderIndent();
+    context.Write("  </symbol>"sv);
+}
+
+// ----------Use----------------------
+
+Use& Use::SetSymbol(std::string id) {
+    id_ = std::move(id);
+    return *this;
+}
+
+Use& Use::SetPosition(Point position) {
+    position_ = position;
+    return *this;
+}
+
+void Use::RenderObject(const RenderContext& context) const {
+    context.Write("<use href=\"#"sv);
+    context.WriteEscaped(id_);
+    context.Write("\" x=\""sv);
+    context.WriteNumber(position_.x);
+    context.Write("\" y=\""sv);
+    context.WriteNumber(position_.y);
+    context.Write("\"/>"sv);
+}
+
 // ----------Text---------------------
 
 Text& Text::SetPosition(Point pos) {
@@ -130,35 +461,32 @@ Text& Text::SetData(std::string data) {
 }
     
 void Text::RenderObject(const RenderContext& context) const {
-    auto& out = context.out;
-    out << "<text";    
-    PathProps::WriteProps(out);
-    out << " x=\""sv << anchor_point_.x << "\" y=\""sv << anchor_point_.y << "\" "sv;
-    out << "dx=\""sv << offset_.x << "\" dy=\""sv << offset_.y << "\" "sv;
-    out << "font-size=\""sv << font_size_ << "\""sv;
+    context.Write("<text"sv);
+    PathProps::WriteProps(context);
+    context.Write(" x=\""sv);
+    context.WriteNumber(anchor_point_.x);
+    context.Write("\" y=\""sv);
+    context.WriteNumber(anchor_point_.y);
+    context.Write("\" dx=\""sv);
+    context.WriteNumber(offset_.x);
+    context.Write("\" dy=\""sv);
+    context.WriteNumber(offset_.y);
+    context.Write("\" font-size=\""sv);
+    context.WriteNumber(font_size_);
+    context.Write('"');
     if (!font_family_.empty()) {
-        out << " font-family=\""sv << font_family_ << "\""sv;
+        context.Write(" font-family=\""sv);
+        context.Write(font_family_);
+        context.Write('"');
     }
     if (!font_weight_.empty()) {
-        out << " font-weight=\""sv << font_weight_ << "\""sv;
+        context.Write(" font-weight=\""sv);
+        context.Write(font_weight_);
+        context.Write('"');
     }
-    out << ">";
-    for (const auto& ch : data_) {
-        if (ch == '\"') {
-            out << "&quot;";
-        } else if (ch == '\'') {
-            out << "&apos;";
-        } else if (ch == '<') {
-            out << "&lt;";
-        } else if (ch == '>') {
-            out << "&gt;";
-        } else if (ch == '&') {
-            out << "&amp;";
-        } else {
-            out << ch;
-        }
-    }
-    out << "</text>"sv;
+    context.Write('>');
+    context.WriteEscaped(data_);
+    context.Write("</text>"sv);
 }
     
 // ----------Polyline------------------
@@ -169,41 +497,65 @@ Polyline& Polyline::AddPoint(Point point) {
 }
     
 void Polyline::RenderObject(const RenderContext& context) const {
-    auto& out = context.out;
-    out << "<polyline points=\""sv;
+    const auto& options = context.options;
+    if (options.precision >= 0 && options.min_path_points > 0 && points_.size() >= options.min_path_points) {
+        RenderPath(context);
+        return;
+    }
+    context.Write("<polyline points=\""sv);
     bool need_space = false;
     for (const auto& p : points_) {
         if (need_space) {
-            out << ' ';
+            context.Write(' ');
         } else {
             need_space = true;
         }
-        out << p.x << ',' << p.y;
+        context.WriteNumber(p.x);
+        context.Write(',');
+        context.WriteNumber(p.y);
     }
-    out << "\"";
-    PathProps::WriteProps(out);
-    out << "/>"sv;
+    context.Write('"');
+    PathProps::WriteProps(context);
+    context.Write("/>"sv);
 }
 
-template<class T>
-void PathProps<T>::WriteProps(std::ostream& out) const {
-            if (fill_) {
-                out << " fill=\""sv << *fill_ << "\""sv;
-            }
-            if (stroke_) {
-                out << " stroke=\""sv << *stroke_ << "\""sv;
-            }
-            if (stroke_width_) {
-                out << " stroke-width=\""sv << *stroke_width_ << "\""sv;
-            }
-            if (stroke_linecap_) {
-                out << " stroke-linecap=\""sv << *stroke_linecap_ << "\""sv;
-            }
-            if (stroke_linejoin_) {
-                out << " stroke-linejoin=\""sv << *stroke_linejoin_ << "\""sv;
-            }
+/*
+ * Первая точка задаётся абсолютно (M), остальные - смещением от предыдущей (l).
+ * Смещения считаются между округлёнными координатами в единицах последнего знака,
+ * поэтому ошибка округления не накапливается вдоль ломаной
+ */
+void Polyline::RenderPath(const RenderContext& context) const {
+    const int precision = std::min(context.options.precision, RenderOptions::kMaxPrecision);
+    std::vector<std::pair<int64_t, int64_t>> units(points_.size());
+    for (size_t i = 0; i < points_.size(); ++i) {
+        if (!ToUnits(points_[i].x, precision, units[i].first) || !ToUnits(points_[i].y, precision, units[i].second)) {
+            // Слишком большие координаты выводятся ломаной в абсолютных координатах
+            RenderContext absolute = context;
+            absolute.options.min_path_points = 0;
+            RenderObject(absolute);
+            return;
         }
-    
+    }
+    auto& out = context.out;
+    out.append("<path d=\"M"sv);
+    WriteUnits(out, units[0].first, precision);
+    WriteSeparated(out, ',', units[0].second, precision);
+    for (size_t i = 1; i < units.size(); ++i) {
+        const int64_t dx = units[i].first - units[i - 1].first;
+        const int64_t dy = units[i].second - units[i - 1].second;
+        if (i == 1) {
+            out.push_back('l');
+            WriteUnits(out, dx, precision);
+        } else {
+            WriteSeparated(out, ' ', dx, precision);
+        }
+        WriteSeparated(out, ',', dy, precision);
+    }
+    out.push_back('"');
+    PathProps::WriteProps(context);
+    out.append("/>"sv);
+}
+
 void Star::Draw(svg::ObjectContainer& container) const {
     container.Add(::CreateStar(center_, outer_rad_, inner_rad_, num_rays_));
 }
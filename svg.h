@@ -5,8 +5,10 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <optional>
+#include <unordered_map>
 
 namespace svg {
     
@@ -75,32 +77,111 @@ struct Point {
     double y = 0;
 };
 
+// Видимая область документа: прямоугольник холста, который растягивается на окно просмотра
+struct ViewBox {
+    Point min;
+    double width = 0;
+    double height = 0;
+};
+
+/*
+ * Формат вывода чисел. По умолчанию числа выводятся с 6 значащими цифрами, как при выводе в ostream.
+ * При precision >= 0 - с precision знаками после запятой без незначащих нулей.
+ * Ломаные из min_path_points и более точек при precision >= 0 выводятся элементом <path>
+ * с относительными координатами: каждая точка задаётся смещением от предыдущей
+ */
+struct RenderOptions {
+    // Не больше kMaxPrecision
+    int precision = -1;
+    // 0 - ломаные всегда выводятся элементом <polyline>
+    size_t min_path_points = 0;
+    // Стили элементов выводятся CSS-классами, см. StyleTable
+    bool css_classes = false;
+
+    static constexpr int kMaxPrecision = 9;
+};
+
+// Оформление линий и заливки элемента. Незаданные свойства не выводятся
+struct Style {
+    std::optional<Color> fill;
+    std::optional<Color> stroke;
+    std::optional<double> stroke_width;
+    std::optional<StrokeLineCap> stroke_linecap;
+    std::optional<StrokeLineJoin> stroke_linejoin;
+
+    bool operator==(const Style&) const = default;
+};
+
+struct StyleHasher {
+    size_t operator()(const Style& style) const;
+};
+
+struct RenderContext;
+
+/*
+ * Таблица различных стилей документа. Каждый стиль получает CSS-класс s<номер>,
+ * элементы ссылаются на класс вместо повторения атрибутов оформления
+ */
+class StyleTable {
+public:
+    // Номер стиля, равного style, добавленного ранее, либо номер нового стиля
+    uint32_t Add(const Style& style);
+    size_t GetSize() const;
+    // Выводит элемент <style> с правилами всех классов
+    void Render(const RenderContext& context) const;
+
+private:
+    std::vector<Style> styles_;
+    std::unordered_map<Style, uint32_t, StyleHasher> ids_;
+};
+
 /*
  * Вспомогательная структура, хранящая контекст для вывода SVG-документа с отступами.
- * Хранит ссылку на поток вывода, текущее значение и шаг отступа при выводе элемента
+ * Хранит ссылку на буфер вывода, формат чисел, текущее значение и шаг отступа при выводе элемента
  */
 struct RenderContext {
-    RenderContext(std::ostream& out)
-        : out(out) {
+    RenderContext(std::string& out, RenderOptions options = {})
+        : out(out)
+        , options(options) {
     }
 
-    RenderContext(std::ostream& out, int indent_step, int indent = 0)
+    RenderContext(std::string& out, RenderOptions options, int indent_step, int indent = 0)
         : out(out)
+        , options(options)
         , indent_step(indent_step)
         , indent(indent) {
     }
 
     RenderContext Indented() const {
-        return {out, indent_step, indent + indent_step};
+        RenderContext indented {out, options, indent_step, indent + indent_step};
+        indented.styles = styles;
+        return indented;
     }
 
     void RenderIndent() const {
-        for (int i = 0; i < indent; ++i) {
-            out.put(' ');
-        }
+        out.append(static_cast<size_t>(indent), ' ');
     }
 
-    std::ostream& out;
+    void Write(std::string_view text) const {
+        out.append(text);
+    }
+
+    void Write(char c) const {
+        out.push_back(c);
+    }
+
+    void WriteNumber(double value) const;
+    void WriteNumber(uint32_t value) const;
+    // Экранирует спецсимволы XML
+    void WriteEscaped(std::string_view text) const;
+
+    // Оформление элемента: атрибуты либо класс из таблицы styles
+    void WriteStyle(const Style& style) const;
+
+    std::string& out;
+    RenderOptions options;
+    // Задана при выводе стилей CSS-классами
+    StyleTable* styles = nullptr;
     int indent_step = 0;
     int indent = 0;
 };
@@ -125,37 +206,55 @@ private:
  * https://developer.mozilla.org/en-US/docs/Web/SVG/Element/circle
  */
 
+/*
+ * Оформление хранится в разделяемом неизменяемом Style. Элементы с одинаковым оформлением
+ * могут ссылаться на один Style через SetStyle, сеттеры копируют разделяемый стиль перед изменением
+ */
 template<class T>
 class PathProps {
     public:
         T& SetFillColor(Color color){
-            fill_ = color;
+            MutableStyle().fill = std::move(color);
             return *static_cast<T*>(this);
         }
         T& SetStrokeColor(Color color){
-            stroke_ = color;
+            MutableStyle().stroke = std::move(color);
             return *static_cast<T*>(this);
         }
         T& SetStrokeWidth(double width){
-            stroke_width_ = width;
+            MutableStyle().stroke_width = width;
             return *static_cast<T*>(this);
         }
         T& SetStrokeLineCap(StrokeLineCap line_cap){
-            stroke_linecap_ = line_cap;
+            MutableStyle().stroke_linecap = line_cap;
             return *static_cast<T*>(this);
         }
         T& SetStrokeLineJoin(StrokeLineJoin line_join) {
-            stroke_linejoin_ = line_join;
+            MutableStyle().stroke_linejoin = line_join;
             return *static_cast<T*>(this);
         }
-        void WriteProps(std::ostream& context) const;
-protected:
-    
-    std::optional<Color> fill_;
-    std::optional<Color> stroke_;
-    std::optional<double> stroke_width_;
-    std::optional<StrokeLineCap> stroke_linecap_;
-    std::optional<StrokeLineJoin> stroke_linejoin_;
+        T& SetStyle(std::shared_ptr<const Style> style) {
+            style_ = std::move(style);
+            owns_style_ = false;
+            return *static_cast<T*>(this);
+        }
+        void WriteProps(const RenderContext& context) const {
+            if (style_) {
+                context.WriteStyle(*style_);
+            }
+        }
+private:
+    // Стиль, заданный через SetStyle, мог быть создан константным, поэтому изменяется только своя копия
+    Style& MutableStyle() {
+        if (!owns_style_ || style_.use_count() > 1) {
+            style_ = style_ ? std::make_shared<Style>(*style_) : std::make_shared<Style>();
+            owns_style_ = true;
+        }
+        return const_cast<Style&>(*style_);
+    }
+
+    std::shared_ptr<const Style> style_;
+    bool owns_style_ = false;
 };
      
 class Circle final : public Object, public PathProps<Circle> {
@@ -186,6 +285,8 @@ public:
      */
     void RenderObject(const RenderContext& context) const override;
 private:
+    void RenderPath(const RenderContext& context) const;
+
     std::vector<Point> points_;
 };
 
@@ -226,6 +327,38 @@ private:
     std::string font_weight_;
 };
 
+/*
+ * Класс Symbol моделирует элемент <symbol>: шаблон, который выводится один раз
+ * и повторяется элементами <use>. Вложенные объекты задаются относительно начала координат
+ * https://developer.mozilla.org/en-US/docs/Web/SVG/Element/symbol
+ */
+class Symbol final : public Object, public ObjectContainer {
+public:
+    explicit Symbol(std::string id);
+
+    void AddPtr(std::unique_ptr<Object>&& obj) override;
+
+    void RenderObject(const RenderContext& context) const override;
+private:
+    std::string id_;
+    std::vector<std::unique_ptr<Object>> objects_;
+};
+
+/*
+ * Класс Use моделирует элемент <use>: копию шаблона Symbol со сдвигом начала координат в точку position
+ * https://developer.mozilla.org/en-US/docs/Web/SVG/Element/use
+ */
+class Use final : public Object {
+public:
+    Use& SetSymbol(std::string id);
+    Use& SetPosition(Point position);
+
+    void RenderObject(const RenderContext& context) const override;
+private:
+    std::string id_;
+    Point position_;
+};
+
        
 class Document : public ObjectContainer {
 public:
@@ -234,13 +367,44 @@ public:
     void AddPtr(std::unique_ptr<Object>&& obj) override;
 
     // Выводит в ostream svg-представление документа
-    void Render(std::ostream& out) const;
+    void Render(std::ostream& out, RenderOptions options = {}) const;
+    // Дописывает svg-представление документа в конец буфера
+    void Render(std::string& out, RenderOptions options = {}) const;
 
     // Прочие методы и данные, необходимые для реализации класса Document
 private:
     std::vector<std::unique_ptr<Object>> objects_;
 };
-    
+
+/*
+ * Выводит объекты сразу при добавлении, не храня их.
+ * Заголовок документа выводится при создании, закрывающий тег - в Close.
+ * Если задана view_box, она выводится атрибутом viewBox элемента <svg>.
+ * При выводе в ostream текст копится в буфере и записывается в поток блоками
+ */
+class DocumentStream : public ObjectContainer {
+public:
+    explicit DocumentStream(std::ostream& out, RenderOptions options = {},
+                            std::optional<ViewBox> view_box = std::nullopt);
+    // Дописывает документ в конец буфера
+    explicit DocumentStream(std::string& out, RenderOptions options = {},
+                            std::optional<ViewBox> view_box = std::nullopt);
+
+    void AddPtr(std::unique_ptr<Object>&& obj) override;
+    // Выводит объект без выделения памяти под его копию
+    void Render(const Object& obj);
+    void Close();
+
+private:
+    void WriteHeader(const std::optional<ViewBox>& view_box);
+    void FlushIfFull();
+
+    std::ostream* stream_ = nullptr;
+    std::string buffer_;
+    StyleTable styles_;
+    RenderContext context_;
+};
+
 namespace shapes {
 
 class Triangle : public svg::Drawable {
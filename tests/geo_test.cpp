@@ -0,0 +1,152 @@
+/*
+ * Пакетный расчёт расстояний: обе реализации (скалярная и AVX2) укладываются в погрешность,
+ * описанную в geo.cpp, совпадают между собой побитово и отличаются от ComputeDistance
+ * не больше, чем на погрешность формулы через acos.
+ * Сборка из корня репозитория:
+ *   g++ -std=c++20 -O2 -I. tests/geo_test.cpp geo.cpp -o geo_test
+ */
+
+#include "testing.h"
+
+#include "geo.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+struct Pairs {
+    std::vector<geo::Coordinates> from;
+    std::vector<geo::Coordinates> to;
+    std::vector<geo::PreparedCoordinates> prepared_from;
+    std::vector<geo::PreparedCoordinates> prepared_to;
+
+    void Add(geo::Coordinates a, geo::Coordinates b) {
+        from.push_back(a);
+        to.push_back(b);
+        prepared_from.push_back(geo::Prepare(a));
+        prepared_to.push_back(geo::Prepare(b));
+    }
+};
+
+// Пары по всему земному шару, пары в пределах города (вплоть до совпадающих точек) и почти противоположные
+Pairs MakePairs() {
+    std::mt19937_64 random(20);
+    std::uniform_real_distribution<double> lat(-89.9, 89.9);
+    std::uniform_real_distribution<double> lng(-180.0, 180.0);
+    std::uniform_real_distribution<double> offset(-0.03, 0.03);
+    std::uniform_real_distribution<double> tiny(-1e-5, 1e-5);
+    Pairs pairs;
+    for (int i = 0; i < 20000; ++i) {
+        pairs.Add({lat(random), lng(random)}, {lat(random), lng(random)});
+        const geo::Coordinates city{55.5 + offset(random), 37.6 + offset(random)};
+        pairs.Add(city, {city.lat + offset(random), city.lng + offset(random)});
+        pairs.Add(city, {city.lat + tiny(random), city.lng + tiny(random)});
+        const geo::Coordinates point{lat(random), lng(random)};
+        pairs.Add(point, {-point.lat + tiny(random), point.lng + (point.lng > 0 ? -180.0 : 180.0) + tiny(random)});
+    }
+    pairs.Add({55.0, 37.0}, {55.0, 37.0});
+    return pairs;
+}
+
+// Формула гаверсинусов в long double по тем же радианам, что получает ядро
+long double ReferenceDistance(const geo::PreparedCoordinates& from, const geo::PreparedCoordinates& to) {
+    const long double s_lat = std::sin((static_cast<long double>(to.lat) - from.lat) / 2);
+    const long double s_lng = std::sin((static_cast<long double>(to.lng) - from.lng) / 2);
+    const long double h = s_lat * s_lat + std::cos(static_cast<long double>(from.lat))
+        * std::cos(static_cast<long double>(to.lat)) * s_lng * s_lng;
+    return 2.0L * geo::EarthRadius * std::asin(std::sqrt(std::min(h, 1.0L)));
+}
+
+std::vector<double> Compute(const Pairs& pairs, geo::DistanceKernel kernel) {
+    std::vector<double> distances(pairs.from.size());
+    geo::ComputeDistances(pairs.prepared_from, pairs.prepared_to, distances, kernel);
+    return distances;
+}
+
+// Вклад округления h из geo.cpp: 16ε·R·tg(θ/2), θ = d / R, но не больше 4R·√ε у почти противоположных точек
+double HaversineRounding(double distance) {
+    constexpr double kEpsilon = std::numeric_limits<double>::epsilon();
+    const double half_angle = distance / geo::EarthRadius / 2;
+    return 16 * kEpsilon * geo::EarthRadius * std::sin(half_angle)
+        / std::max(std::cos(half_angle), std::sqrt(16 * kEpsilon));
+}
+
+// Погрешность относительно эталона: 5e-15 от расстояния плюс вклад округления h
+void CheckAccuracy(const Pairs& pairs, const std::vector<double>& distances) {
+    for (size_t i = 0; i < distances.size(); ++i) {
+        const long double reference = ReferenceDistance(pairs.prepared_from[i], pairs.prepared_to[i]);
+        CHECK(std::fabs(distances[i] - reference)
+              <= 5e-15 * reference + HaversineRounding(static_cast<double>(reference)));
+    }
+}
+
+// Формула через acos теряет точность у близких и у противоположных точек: ошибка аргумента acos
+// порядка 1e-16 даёт ошибку расстояния до R·√(2·1e-16), около 0.1 м
+void CheckAgainstComputeDistance(const Pairs& pairs, const std::vector<double>& distances) {
+    for (size_t i = 0; i < distances.size(); ++i) {
+        const double expected = geo::ComputeDistance(pairs.from[i], pairs.to[i]);
+        CHECK(std::fabs(distances[i] - expected) <= 0.2 + 1e-9 * expected + HaversineRounding(expected));
+    }
+}
+
+bool SameBits(const std::vector<double>& lhs, const std::vector<double>& rhs) {
+    return lhs.size() == rhs.size() && std::memcmp(lhs.data(), rhs.data(), lhs.size() * sizeof(double)) == 0;
+}
+
+void TestScalarFallback(const Pairs& pairs) {
+    CHECK(geo::IsSupported(geo::DistanceKernel::Scalar));
+    const auto distances = Compute(pairs, geo::DistanceKernel::Scalar);
+    CheckAccuracy(pairs, distances);
+    CheckAgainstComputeDistance(pairs, distances);
+}
+
+void TestAvx2(const Pairs& pairs) {
+    if (!geo::IsSupported(geo::DistanceKernel::Avx2)) {
+        std::vector<double> distances(pairs.from.size());
+        CHECK_THROWS(geo::ComputeDistances(pairs.prepared_from, pairs.prepared_to, distances,
+                                           geo::DistanceKernel::Avx2),
+                     std::invalid_argument);
+        std::cout << "geo_test: AVX2 is not supported, only the scalar kernel is checked\n";
+        return;
+    }
+    const auto distances = Compute(pairs, geo::DistanceKernel::Avx2);
+    CheckAccuracy(pairs, distances);
+    CheckAgainstComputeDistance(pairs, distances);
+    CHECK(SameBits(distances, Compute(pairs, geo::DistanceKernel::Scalar)));
+
+    // Неполные четвёрки в конце массива дополняются и тоже совпадают со скалярной версией
+    for (size_t count = 0; count <= 13; ++count) {
+        Pairs part;
+        for (size_t i = 0; i < count; ++i) {
+            part.Add(pairs.from[i * 3], pairs.to[i * 3]);
+        }
+        CHECK(SameBits(Compute(part, geo::DistanceKernel::Avx2), Compute(part, geo::DistanceKernel::Scalar)));
+    }
+}
+
+// Выбор реализации по процессору совпадает с явным выбором любой из них
+void TestAuto(const Pairs& pairs) {
+    std::vector<double> distances(pairs.from.size());
+    geo::ComputeDistances(pairs.prepared_from, pairs.prepared_to, distances);
+    CHECK(SameBits(distances, Compute(pairs, geo::DistanceKernel::Auto)));
+    CHECK(SameBits(distances, Compute(pairs, geo::DistanceKernel::Scalar)));
+
+    std::vector<double> short_output(1);
+    CHECK_THROWS(geo::ComputeDistances(pairs.prepared_from, pairs.prepared_to, short_output), std::invalid_argument);
+}
+
+}
+
+int main() {
+    const Pairs pairs = MakePairs();
+    TestScalarFallback(pairs);
+    TestAvx2(pairs);
+    TestAuto(pairs);
+    std::cout << "geo_test: OK\n";
+}
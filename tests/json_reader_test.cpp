@@ -0,0 +1,220 @@
+/*
+ * Запросы на наполнение базы применяются целиком или не применяются вовсе,
+ * а ошибка называет неизвестную остановку. Запрос без обязательного поля отклоняется при разборе,
+ * повторный ключ заменяет значение. Запросы Route и Map к снимку отклоняются.
+ * Сборка из корня репозитория:
+ *   g++ -std=c++20 -O2 -pthread -I. tests/json_reader_test.cpp $(ls *.cpp | grep -v main.cpp) -o json_reader_test
+ */
+
+#include "testing.h"
+
+#include "catalogue_snapshot.h"
+#include "json_reader.h"
+#include "transport_catalogue.h"
+#include "versioned_catalogue.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+using namespace std::literals;
+
+namespace {
+
+const std::string_view kBase = R"({"base_requests": [
+    {"type": "Stop", "name": "A", "latitude": 55.61, "longitude": 37.20, "road_distances": {"B": 3900}},
+    {"type": "Stop", "name": "B", "latitude": 55.59, "longitude": 37.21, "road_distances": {}},
+    {"type": "Bus", "name": "1", "stops": ["A", "B"], "is_roundtrip": false}
+]})"sv;
+
+void Apply(std::string_view line, transport::CatalogueBuilder& db) {
+    JsonReader reader;
+    reader.ParseRequest(line);
+    reader.ApplyBaseRequests(db);
+}
+
+// Применяет строку, которая должна завершиться ошибкой, и возвращает её текст
+std::string ApplyFailing(std::string_view line, transport::CatalogueBuilder& db) {
+    try {
+        Apply(line, db);
+    } catch (const std::out_of_range& e) {
+        return e.what();
+    }
+    std::cerr << "out_of_range expected for " << line << '\n';
+    std::exit(1);
+}
+
+// Ошибочная строка не меняет справочник, даже если её первые запросы корректны
+void CheckRejected(std::string_view line, std::string_view message) {
+    transport::CatalogueBuilder db;
+    Apply(kBase, db);
+    const auto revision = db.GetRevision();
+    CHECK(ApplyFailing(line, db) == message);
+    CHECK(db.GetRevision() == revision);
+    CHECK(!db.HasStop("Y"sv));
+    const auto frozen = db.Freeze();
+    CHECK(!frozen.GetStop("Y"sv));
+    CHECK(!frozen.GetBus("X"sv));
+    CHECK(frozen.GetStat(frozen.GetBus("1"sv))->dist == 7800);
+}
+
+void TestBusWithUnknownStop() {
+    CheckRejected(R"({"type": "Bus", "name": "X", "stops": ["A", "ZZ"], "is_roundtrip": true})"sv,
+                  "stop ZZ in bus X not found in base"sv);
+}
+
+void TestDistanceToUnknownStop() {
+    CheckRejected(R"({"type": "Stop", "name": "Y", "latitude": 55.6, "longitude": 37.2, "road_distances": {"ZZ": 100}})"sv,
+                  "stop ZZ in road distances of stop Y not found in base"sv);
+}
+
+void TestNewStopAndBusWithUnknownStop() {
+    CheckRejected(R"({"base_requests": [
+        {"type": "Stop", "name": "Y", "latitude": 55.6, "longitude": 37.2, "road_distances": {"A": 100}},
+        {"type": "Bus", "name": "X", "stops": ["Y", "ZZ"], "is_roundtrip": true}]})"sv,
+                  "stop ZZ in bus X not found in base"sv);
+}
+
+// Остановки, добавленные в той же строке, известны маршрутам и расстояниям этой строки
+void TestStopsFromSameLine() {
+    transport::CatalogueBuilder db;
+    Apply(kBase, db);
+    Apply(R"({"base_requests": [
+        {"type": "Bus", "name": "X", "stops": ["Y", "A"], "is_roundtrip": false},
+        {"type": "Stop", "name": "Y", "latitude": 55.6, "longitude": 37.2, "road_distances": {"A": 100}}]})"sv, db);
+    const auto frozen = db.Freeze();
+    CHECK(frozen.GetStat(frozen.GetBus("X"sv))->dist == 200);
+}
+
+// Прямые вызовы CatalogueBuilder тоже называют неизвестную остановку
+void TestBuilderErrors() {
+    transport::CatalogueBuilder db;
+    db.AddStop("A"sv, {55.6, 37.2});
+    CHECK_THROWS(db.AddBus("X"sv, {"A"sv, "ZZ"sv}, true), std::out_of_range);
+    CHECK_THROWS(db.AddDistance("A"sv, "ZZ"sv, 100), std::out_of_range);
+    try {
+        db.AddDistance("ZZ"sv, "A"sv, 100);
+        CHECK(false);
+    } catch (const std::out_of_range& e) {
+        CHECK(std::string_view(e.what()).find("ZZ"sv) != std::string_view::npos);
+    }
+    CHECK(db.GetRevision() == 1);
+}
+
+// Сценарий режима JSON Lines: отклонённая строка не попадает в следующие версии
+void TestRejectedLineIsNotPublishedLater() {
+    auto update = [](transport::VersionedCatalogue& catalogue, std::string_view line) {
+        JsonReader reader;
+        reader.ParseRequest(line);
+        return catalogue.Update(reader.MakeDelta());
+    };
+    transport::VersionedCatalogue catalogue;
+    update(catalogue, kBase);
+    const auto before = catalogue.Acquire();
+    CHECK_THROWS(update(catalogue, R"({"base_requests": [
+        {"type": "Stop", "name": "Y", "latitude": 55.6, "longitude": 37.2, "road_distances": {}},
+        {"type": "Bus", "name": "X", "stops": ["Y", "ZZ"], "is_roundtrip": true}]})"sv), std::out_of_range);
+    CHECK(catalogue.Acquire() == before);
+    CHECK(!catalogue.Acquire()->GetStop("Y"sv));
+
+    const auto version = update(catalogue,
+        R"({"type": "Stop", "name": "W", "latitude": 55.6, "longitude": 37.2, "road_distances": {}})"sv);
+    CHECK(version->GetStop("W"sv));
+    CHECK(!version->GetStop("Y"sv));
+    CHECK(!version->GetBus("X"sv));
+}
+
+// Разбирает запрос, который должен завершиться ошибкой, и возвращает её текст
+std::string ParseFailing(std::string_view request) {
+    try {
+        JsonReader reader;
+        reader.ParseRequest(request);
+    } catch (const json::ParsingError& e) {
+        return e.what();
+    }
+    std::cerr << "ParsingError expected for " << request << '\n';
+    std::exit(1);
+}
+
+void TestMissingRequiredFields() {
+    CHECK(ParseFailing(R"({"type": "Stop", "name": "A"})"sv) == "missing field \"latitude\""sv);
+    CHECK(ParseFailing(R"({"type": "Stop", "name": "A", "latitude": 55.6})"sv) == "missing field \"longitude\""sv);
+    CHECK(ParseFailing(R"({"type": "Stop", "latitude": 55.6, "longitude": 37.2})"sv) == "missing field \"name\""sv);
+    CHECK(ParseFailing(R"({"type": "Bus", "name": "1", "stops": ["A"]})"sv) == "missing field \"is_roundtrip\""sv);
+    CHECK(ParseFailing(R"({"type": "Bus", "name": "1", "is_roundtrip": true})"sv) == "missing field \"stops\""sv);
+    CHECK(ParseFailing(R"({"id": 1, "name": "1"})"sv) == "missing field \"type\""sv);
+    CHECK(ParseFailing(R"({"base_requests": [], "stat_requests": [{"type": "Bus", "name": "1"}]})"sv)
+          == "missing field \"id\""sv);
+    CHECK(ParseFailing(R"({"routing_settings": {"bus_wait_time": 6}})"sv) == "missing field \"bus_velocity\""sv);
+
+    // Потоковый разбор проверяет поля так же
+    std::istringstream input(R"({"base_requests": [{"type": "Stop", "name": "A", "longitude": 37.2}]})");
+    CHECK_THROWS(JsonReader().ParseCommands(input), json::ParsingError);
+
+    // Необязательные поля можно не задавать
+    transport::CatalogueBuilder db;
+    Apply(R"({"type": "Stop", "name": "A", "latitude": 55.6, "longitude": 37.2})"sv, db);
+    CHECK(db.HasStop("A"sv));
+    JsonReader reader;
+    reader.ParseRequest(R"({"id": 1, "type": "Map"})"sv);
+}
+
+// Повторный ключ заменяет массив или словарь, а не дописывает его элементы к прежним
+void TestDuplicateKeyReplaces() {
+    transport::CatalogueBuilder db;
+    Apply(kBase, db);
+    Apply(R"({"type": "Bus", "name": "X", "stops": ["A", "ZZ"], "stops": ["A", "B"], "is_roundtrip": false})"sv, db);
+    Apply(R"({"type": "Stop", "name": "B", "latitude": 55.59, "longitude": 37.21,
+              "road_distances": {"ZZ": 1}, "road_distances": {"A": 1000}})"sv, db);
+    const auto frozen = db.Freeze();
+    const auto stat = frozen.GetStat(frozen.GetBus("X"sv));
+    CHECK(stat && stat->stops_count == 3 && stat->unique_stops == 2);
+    CHECK(stat->dist == 4900);
+}
+
+// Снимок не хранит расстояний и признака кольцевого маршрута: запросы Route и Map отклоняются целиком
+void TestSnapshotRejectsRouteAndMap() {
+    transport::CatalogueBuilder db;
+    Apply(kBase, db);
+    const std::string path = (std::filesystem::temp_directory_path() / "json_reader_test.snapshot").string();
+    {
+        std::ofstream out(path, std::ios::binary);
+        transport::SaveSnapshot(db.Freeze(), out);
+    }
+    const transport::CatalogueSnapshot snapshot(path);
+
+    auto answer = [&snapshot](std::string_view requests) {
+        JsonReader reader;
+        reader.ParseCommands(requests);
+        std::string output;
+        json::Writer writer(output, json::PrintMode::Compact);
+        reader.AnswerStatRequests(snapshot, writer);
+        return output;
+    };
+    CHECK(answer(R"({"stat_requests": [{"id": 1, "type": "Bus", "name": "1"}]})"sv).find("\"route_length\":7800")
+          != std::string::npos);
+    for (const auto requests : {R"({"stat_requests": [{"id": 1, "type": "Bus", "name": "1"},
+                                    {"id": 2, "type": "Route", "from": "A", "to": "B"}]})"sv,
+                                R"({"stat_requests": [{"id": 3, "type": "Map"}]})"sv}) {
+        CHECK_THROWS(answer(requests), std::invalid_argument);
+    }
+    std::remove(path.c_str());
+}
+}
+
+int main() {
+    TestBusWithUnknownStop();
+    TestDistanceToUnknownStop();
+    TestNewStopAndBusWithUnknownStop();
+    TestStopsFromSameLine();
+    TestBuilderErrors();
+    TestRejectedLineIsNotPublishedLater();
+    TestMissingRequiredFields();
+    TestDuplicateKeyReplaces();
+    TestSnapshotRejectsRouteAndMap();
+    std::cout << "json_reader_test: OK\n";
+}
@@ -0,0 +1,150 @@
+/*
+ * Потоковый разбор JSON кусками должен давать тот же результат, что и разбор документа целиком,
+ * при любом положении границ кусков.
+ * Сборка из корня репозитория:
+ *   g++ -std=c++20 -O2 -pthread -I. tests/json_stream_test.cpp $(ls *.cpp | grep -v main.cpp) -o json_stream_test
+ */
+
+#include "testing.h"
+
+#include "json.h"
+#include "json_reader.h"
+#include "transport_catalogue.h"
+
+#include <sstream>
+#include <string>
+#include <string_view>
+
+using namespace std::literals;
+
+namespace {
+
+// Записывает события разбора в строку, чтобы сравнивать их последовательности
+class RecordingHandler : public json::Handler {
+public:
+    void StartObject() override { events += "{"; }
+    void EndObject() override { events += "}"; }
+    void StartArray() override { events += "["; }
+    void EndArray() override { events += "]"; }
+    void Key(std::string_view key) override { events += "k:"s.append(key) + ';'; }
+    void String(std::string_view value) override { events += "s:"s.append(value) + ';'; }
+    void Int(int value) override { events += "i:" + std::to_string(value) + ';'; }
+    void Double(double value) override { events += "d:" + std::to_string(value) + ';'; }
+    void Bool(bool value) override { events += value ? "true;" : "false;"; }
+    void Null() override { events += "null;"; }
+
+    std::string events;
+};
+
+const std::string_view kDocument = R"({
+    "name": "Улица \"Лизы Чайкиной\"",
+    "escapes": "a\\b\nA\t",
+    "numbers": [0, -12, 2147483647, 2147483648, 1.5e-3, -0.25, 55.611087],
+    "nested": {"empty_dict": {}, "empty_array": [], "deep": [[[{"x": [true, false, null]}]]]},
+    "text]with{brackets": "}]\"[{"
+})"sv;
+
+void TestNodeAndEventsMatchWholeDocument() {
+    const json::Document whole = json::Load(kDocument);
+    RecordingHandler whole_events;
+    json::Parse(kDocument, whole_events);
+
+    for (const size_t chunk_size : {1, 2, 3, 5, 7, 16, 4096}) {
+        std::istringstream input{std::string(kDocument)};
+        CHECK(json::StreamReader(input, chunk_size).ReadNode() == whole.GetRoot());
+
+        std::istringstream events_input{std::string(kDocument)};
+        RecordingHandler events;
+        json::StreamReader(events_input, chunk_size).Parse(events);
+        CHECK(events.events == whole_events.events);
+    }
+
+    std::istringstream input{std::string(kDocument)};
+    CHECK(json::Load(input).GetRoot() == whole.GetRoot());
+}
+
+void TestReadRawAndSkip() {
+    const std::string document = R"([ {"a": "]"} , "x\"y" ,12.5,true , [1, [2]] ])";
+    for (const size_t chunk_size : {1, 2, 4, 4096}) {
+        std::istringstream input(document);
+        json::StreamReader reader(input, chunk_size);
+        reader.StartArray();
+        CHECK(reader.NextElement());
+        CHECK(reader.ReadRaw() == R"({"a": "]"})"sv);
+        CHECK(reader.NextElement());
+        CHECK(reader.ReadRaw() == R"("x\"y")"sv);
+        CHECK(reader.NextElement());
+        CHECK(reader.ReadRaw() == "12.5"sv);
+        CHECK(reader.NextElement());
+        reader.Skip();
+        CHECK(reader.NextElement());
+        reader.Skip();
+        CHECK(!reader.NextElement());
+    }
+}
+
+// Потоковый разбор отклоняет те же документы, что и разбор буфера
+void TestErrors() {
+    for (const std::string& document : {"[1, 2"s, R"({"a" 1})"s, R"({"a": "b)"s, "[1 2]"s, ""s,
+                                         "[12x]"s, "[12x, 3]"s, R"({"a":1.5e})"s, "[truex]"s, "[-]"s}) {
+        CHECK_THROWS(json::Load(std::string_view(document)), json::ParsingError);
+        for (const size_t chunk_size : {1, 2, 4096}) {
+            std::istringstream input(document);
+            CHECK_THROWS(json::StreamReader(input, chunk_size).ReadNode(), json::ParsingError);
+            std::istringstream events_input(document);
+            RecordingHandler events;
+            CHECK_THROWS(json::StreamReader(events_input, chunk_size).Parse(events), json::ParsingError);
+        }
+        std::istringstream input(document);
+        CHECK_THROWS(json::Load(input), json::ParsingError);
+    }
+}
+
+std::string MakeCommands(int stops) {
+    std::string text = R"({"base_requests": [)";
+    for (int i = 0; i < stops; ++i) {
+        if (i > 0) {
+            text += ',';
+        }
+        text += R"({"type": "Stop", "name": "S)" + std::to_string(i) + R"(", "latitude": 55.)" + std::to_string(i)
+            + R"(, "longitude": 37.5, "road_distances": {"S)" + std::to_string((i + 1) % stops) + R"(": 900}})";
+    }
+    text += R"(, {"type": "Bus", "name": "1", "stops": ["S0", "S1", "S2"], "is_roundtrip": false}],)";
+    text += R"("stat_requests": [{"id": 1, "type": "Bus", "name": "1"}, {"id": 2, "type": "Stop", "name": "S1"},)";
+    text += R"({"id": 3, "type": "Stop", "name": "S)" + std::to_string(stops - 1) + R"("}]})";
+    return text;
+}
+
+std::string Answer(JsonReader& reader) {
+    transport::CatalogueBuilder db;
+    std::string output;
+    json::Writer writer(output, json::PrintMode::Compact);
+    reader.ApplyCommands(db, writer);
+    return output;
+}
+
+// Запросы из потока разбираются так же, как из буфера, в том числе пакетами в пуле потоков
+void TestCommandsFromStream() {
+    const std::string text = MakeCommands(20000);
+    JsonReader whole;
+    whole.ParseCommands(std::string_view(text));
+    const std::string expected = Answer(whole);
+    CHECK(expected.find("not found"sv) == std::string::npos);
+
+    for (const size_t threads : {1, 3}) {
+        std::istringstream input(text);
+        JsonReader streamed(threads);
+        streamed.ParseCommands(input);
+        CHECK(Answer(streamed) == expected);
+    }
+}
+
+}
+
+int main() {
+    TestNodeAndEventsMatchWholeDocument();
+    TestReadRawAndSkip();
+    TestErrors();
+    TestCommandsFromStream();
+    std::cout << "json_stream_test: OK\n";
+}
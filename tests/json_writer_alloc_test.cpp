@@ -0,0 +1,149 @@
+/*
+ * Ответы на запросы Bus и Stop выводятся через json::Writer без выделения динамической памяти,
+ * если буфер вывода переиспользуется. Выделения считаются заменённым глобальным operator new.
+ * Сборка из корня репозитория:
+ *   g++ -std=c++20 -O2 -pthread -I. tests/json_writer_alloc_test.cpp $(ls *.cpp | grep -v main.cpp) -o json_writer_alloc_test
+ */
+
+#include "testing.h"
+
+#include "json.h"
+#include "json_reader.h"
+#include "transport_catalogue.h"
+
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <string_view>
+
+using namespace std::literals;
+
+namespace {
+
+size_t allocations = 0;
+
+void* Allocate(size_t size) {
+    ++allocations;
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+}
+
+void* operator new(size_t size) {
+    return Allocate(size);
+}
+
+void* operator new[](size_t size) {
+    return Allocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+// Справочник из stops остановок по кругу и маршрутов через каждые пять соседних остановок.
+// Запросы к базе спрашивают о каждом маршруте и каждой остановке, а также о неизвестных
+std::string MakeCommands(int stops) {
+    std::string text = R"({"base_requests": [)";
+    for (int i = 0; i < stops; ++i) {
+        text += R"({"type": "Stop", "name": "Stop )" + std::to_string(i) + R"(", "latitude": 55.)"
+            + std::to_string(1000 + i) + R"(, "longitude": 37.)" + std::to_string(5000 + 7 * i)
+            + R"(, "road_distances": {"Stop )" + std::to_string((i + 1) % stops) + R"(": )"
+            + std::to_string(500 + i) + "}},";
+    }
+    for (int bus = 0; bus < stops; bus += 3) {
+        text += R"({"type": "Bus", "name": "Bus )" + std::to_string(bus) + R"(", "stops": [)";
+        for (int j = 0; j < 5; ++j) {
+            text += (j > 0 ? R"(, "Stop )" : R"("Stop )") + std::to_string((bus + j) % stops) + '"';
+        }
+        text += R"(], "is_roundtrip": false},)";
+    }
+    text.back() = ']';
+    text += R"(, "stat_requests": [)";
+    int id = 0;
+    for (int bus = 0; bus < stops; bus += 3) {
+        text += R"({"id": )" + std::to_string(++id) + R"(, "type": "Bus", "name": "Bus )" + std::to_string(bus) + R"("},)";
+    }
+    for (int stop = 0; stop < stops; ++stop) {
+        text += R"({"id": )" + std::to_string(++id) + R"(, "type": "Stop", "name": "Stop )" + std::to_string(stop) + R"("},)";
+    }
+    text += R"({"id": )" + std::to_string(++id) + R"(, "type": "Bus", "name": "Unknown"},)";
+    text += R"({"id": )" + std::to_string(++id) + R"(, "type": "Stop", "name": "Unknown"}]})";
+    return text;
+}
+
+// Первый проход наращивает буфер, последующие проходы не должны выделять память
+void TestAnswersDoNotAllocate(json::PrintMode mode) {
+    JsonReader reader;
+    reader.ParseCommands(MakeCommands(300));
+    transport::CatalogueBuilder db;
+    reader.ApplyBaseRequests(db);
+    const auto frozen = db.Freeze();
+
+    std::string output;
+    std::string expected;
+    for (int pass = 0; pass < 3; ++pass) {
+        output.clear();
+        const size_t before = allocations;
+        json::Writer writer(output, mode);
+        reader.AnswerStatRequests(frozen, writer);
+        const size_t made = allocations - before;
+        if (pass == 0) {
+            // Буфер вывода растёт, значит замена operator new действительно считает выделения
+            CHECK(made > 0);
+            expected = output;
+            CHECK(expected.find("\"not found\""sv) != std::string::npos);
+            CHECK(expected.find("\"Bus 3\""sv) != std::string::npos);
+        } else {
+            CHECK(made == 0);
+            CHECK(output == expected);
+        }
+    }
+}
+
+void TestWriterValuesDoNotAllocate() {
+    std::string output;
+    output.reserve(4096);
+    const size_t before = allocations;
+    for (const auto mode : {json::PrintMode::Pretty, json::PrintMode::Compact}) {
+        output.clear();
+        json::Writer writer(output, mode);
+        writer.StartArray();
+        for (int i = 0; i < 10; ++i) {
+            writer.StartDict()
+                .Key("curvature"sv).Value(1.23456789 * i)
+                .Key("name"sv).Value("Улица \"Лизы Чайкиной\"\n"sv)
+                .Key("request_id"sv).Value(i)
+                .Key("stops"sv).StartArray().Value(true).Value(nullptr).EndArray()
+                .EndDict();
+        }
+        writer.EndArray();
+    }
+    CHECK(allocations == before);
+}
+
+}
+
+int main() {
+    TestWriterValuesDoNotAllocate();
+    TestAnswersDoNotAllocate(json::PrintMode::Pretty);
+    TestAnswersDoNotAllocate(json::PrintMode::Compact);
+    std::cout << "json_writer_alloc_test: OK\n";
+}
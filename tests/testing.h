@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+
+/*
+ * Простейшие проверки для тестов без внешних зависимостей.
+ * При нарушении условия выводится место проверки, и тест завершается с ненулевым кодом
+ */
+
+#define CHECK(condition)                                                                    \
+    do {                                                                                    \
+        if (!(condition)) {                                                                 \
+            std::cerr << __FILE__ << ':' << __LINE__ << ": check failed: " #condition "\n"; \
+            std::exit(1);                                                                   \
+        }                                                                                   \
+    } while (false)
+
+#define CHECK_THROWS(expression, exception)                                                 \
+    do {                                                                                    \
+        bool thrown = false;                                                                \
+        try {                                                                               \
+            expression;                                                                     \
+        } catch (const exception&) {                                                        \
+            thrown = true;                                                                  \
+        }                                                                                   \
+        if (!thrown) {                                                                      \
+            std::cerr << __FILE__ << ':' << __LINE__ << ": " #exception " expected: "       \
+                      << #expression "\n";                                                  \
+            std::exit(1);                                                                   \
+        }                                                                                   \
+    } while (false)
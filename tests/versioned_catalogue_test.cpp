@@ -0,0 +1,291 @@
+/*
+ * Версии справочника: заморозка с предыдущей версией совпадает с полной заморозкой
+ * и перестраивает только изменённые части, а читатели во время обновлений всегда видят
+ * согласованную опубликованную версию.
+ * Сборка из корня репозитория:
+ *   g++ -std=c++20 -O2 -pthread -I. tests/versioned_catalogue_test.cpp $(ls *.cpp | grep -v main.cpp) -o versioned_catalogue_test
+ */
+
+#include "testing.h"
+
+#include "transport_catalogue.h"
+#include "versioned_catalogue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std::literals;
+using transport::CatalogueBuilder;
+using transport::CatalogueDelta;
+using transport::FrozenCatalogue;
+
+namespace {
+
+// Сравнивает всё, что справочник отдаёт через открытый интерфейс
+void CheckSame(const FrozenCatalogue& lhs, const FrozenCatalogue& rhs) {
+    CHECK(lhs.GetRevision() == rhs.GetRevision());
+    CHECK(lhs.GetStopCount() == rhs.GetStopCount());
+    CHECK(lhs.GetBusCount() == rhs.GetBusCount());
+    for (transport::StopId stop = 0; stop < lhs.GetStopCount(); ++stop) {
+        CHECK(lhs.GetStopName(stop) == rhs.GetStopName(stop));
+        CHECK(lhs.GetStopPlace(stop) == rhs.GetStopPlace(stop));
+        const auto lhs_buses = lhs.GetStopBuses(stop);
+        const auto rhs_buses = rhs.GetStopBuses(stop);
+        CHECK(std::equal(lhs_buses.begin(), lhs_buses.end(), rhs_buses.begin(), rhs_buses.end()));
+    }
+    for (transport::BusId bus = 0; bus < lhs.GetBusCount(); ++bus) {
+        CHECK(lhs.GetBusName(bus) == rhs.GetBusName(bus));
+        CHECK(lhs.IsRoundtrip(bus) == rhs.IsRoundtrip(bus));
+        const auto lhs_route = lhs.GetRoute(bus);
+        const auto rhs_route = rhs.GetRoute(bus);
+        CHECK(std::equal(lhs_route.begin(), lhs_route.end(), rhs_route.begin(), rhs_route.end()));
+        const auto lhs_distances = lhs.GetRouteDistances(bus);
+        const auto rhs_distances = rhs.GetRouteDistances(bus);
+        CHECK(std::equal(lhs_distances.begin(), lhs_distances.end(), rhs_distances.begin(), rhs_distances.end()));
+        std::string lhs_error;
+        std::string rhs_error;
+        std::optional<transport::RouteStatistics> lhs_stat;
+        std::optional<transport::RouteStatistics> rhs_stat;
+        try {
+            lhs_stat = lhs.GetStat(bus);
+        } catch (const std::out_of_range& e) {
+            lhs_error = e.what();
+        }
+        try {
+            rhs_stat = rhs.GetStat(bus);
+        } catch (const std::out_of_range& e) {
+            rhs_error = e.what();
+        }
+        CHECK(lhs_error == rhs_error);
+        CHECK(lhs_stat.has_value() == rhs_stat.has_value());
+        if (lhs_stat) {
+            CHECK(lhs_stat->dist == rhs_stat->dist);
+            CHECK(lhs_stat->stops_count == rhs_stat->stops_count);
+            CHECK(lhs_stat->unique_stops == rhs_stat->unique_stops);
+            CHECK(lhs_stat->curvature == rhs_stat->curvature);
+        }
+    }
+    const auto lhs_box = lhs.GetStopIndex().FindInBox({-90.0, -180.0}, {90.0, 180.0});
+    const auto rhs_box = rhs.GetStopIndex().FindInBox({-90.0, -180.0}, {90.0, 180.0});
+    CHECK(lhs_box == rhs_box);
+}
+
+// Названия хранятся в векторе, чтобы наборы изменений могли ссылаться на них
+class DeltaMaker {
+public:
+    std::string_view Name(std::string name) {
+        return *names_.emplace_back(std::make_unique<std::string>(std::move(name)));
+    }
+
+private:
+    std::vector<std::unique_ptr<std::string>> names_;
+};
+
+// Случайные наборы изменений: новые и перенесённые остановки, расстояния, новые и изменённые маршруты
+void TestIncrementalFreezeMatchesFull() {
+    std::mt19937 random(7);
+    DeltaMaker names;
+    CatalogueBuilder db;
+    std::vector<std::string_view> stops;
+    int bus_count = 0;
+    std::optional<FrozenCatalogue> previous;
+
+    for (int step = 0; step < 300; ++step) {
+        CatalogueDelta delta;
+        const int kind = step < 5 ? 0 : static_cast<int>(random() % 5);
+        auto random_stop = [&]() {
+            return stops[random() % stops.size()];
+        };
+        auto place = [&]() {
+            return geo::Coordinates{55.5 + (random() % 1000) / 2500.0, 37.3 + (random() % 1000) / 1600.0};
+        };
+        if (kind == 0) {
+            const auto name = names.Name("Stop " + std::to_string(stops.size()));
+            stops.push_back(name);
+            delta.stops.push_back({name, place()});
+        } else if (kind == 1) {
+            delta.stops.push_back({random_stop(), place()});
+        } else if (kind == 2) {
+            for (int i = 0; i < 3; ++i) {
+                delta.distances.push_back({random_stop(), random_stop(), 100 + static_cast<int>(random() % 3000)});
+            }
+        } else {
+            const bool is_new = kind == 3 || bus_count == 0;
+            const auto name = names.Name("Bus " + std::to_string(is_new ? bus_count++ : random() % bus_count));
+            std::vector<std::string_view> route;
+            for (size_t i = 0, size = 2 + random() % 5; i < size; ++i) {
+                route.push_back(random_stop());
+            }
+            delta.buses.push_back({name, std::move(route), random() % 2 == 0});
+        }
+        db.Apply(delta);
+
+        auto incremental = db.Freeze(previous ? &*previous : nullptr);
+        CheckSame(incremental, db.Freeze());
+        previous = std::move(incremental);
+    }
+}
+
+// Заморозка строит заново только части, исходные данные которых изменились
+void TestOnlyChangedPartsRebuilt() {
+    DeltaMaker names;
+    CatalogueBuilder db;
+    CatalogueDelta base;
+    for (int i = 0; i < 10; ++i) {
+        base.stops.push_back({names.Name("S" + std::to_string(i)), {55.6 + i / 100.0, 37.5}});
+    }
+    for (int i = 0; i < 10; ++i) {
+        base.distances.push_back({base.stops[i].name, base.stops[(i + 1) % 10].name, 1000});
+    }
+    base.buses.push_back({"Left"sv, {"S0"sv, "S1"sv, "S2"sv, "S1"sv, "S0"sv}, false});
+    base.buses.push_back({"Right"sv, {"S5"sv, "S6"sv, "S7"sv, "S5"sv}, true});
+    db.Apply(base);
+    auto version = db.Freeze();
+    auto before = db.GetFreezeCounters();
+
+    auto freeze = [&](const CatalogueDelta& delta) {
+        db.Apply(delta);
+        auto next = db.Freeze(&version);
+        CheckSame(next, db.Freeze());
+        version = std::move(next);
+        const auto after = db.GetFreezeCounters();
+        // Контрольная полная заморозка выше тоже считается, её вклад вычитается
+        const auto full_buses = version.GetBusCount();
+        transport::FreezeCounters made{after.names - before.names - 1, after.places - before.places - 1,
+                                       after.routes - before.routes - 1, after.bus_stats - before.bus_stats - full_buses};
+        before = after;
+        return made;
+    };
+
+    // Расстояние на участке одного маршрута: пересчитывается только он
+    auto made = freeze({{}, {{"S1"sv, "S2"sv, 1500}}, {}});
+    CHECK(made.names == 0 && made.places == 0 && made.routes == 0 && made.bus_stats == 1);
+    CHECK(version.GetStat(version.GetBus("Left"sv))->dist == 2 * (1000 + 1500));
+
+    // Перенос остановки меняет координаты и статистику проходящего через неё маршрута
+    made = freeze({{{"S6"sv, {55.7, 37.6}}}, {}, {}});
+    CHECK(made.names == 0 && made.places == 1 && made.routes == 0 && made.bus_stats == 1);
+
+    // Расстояние между остановками без маршрутов ничего не пересчитывает
+    made = freeze({{}, {{"S8"sv, "S9"sv, 700}}, {}});
+    CHECK(made.names == 0 && made.places == 0 && made.routes == 0 && made.bus_stats == 0);
+
+    // Изменённый маршрут меняет смещения маршрутов, но не названия и координаты
+    made = freeze({{}, {}, {{"Left"sv, {"S0"sv, "S1"sv}, true}}});
+    CHECK(made.names == 0 && made.places == 0 && made.routes == 1 && made.bus_stats == 2);
+
+    // Новая остановка меняет нумерацию по названиям
+    made = freeze({{{"A"sv, {55.8, 37.8}}}, {}, {}});
+    CHECK(made.names == 1 && made.places == 1 && made.routes == 1);
+}
+
+/*
+ * Писатели обновляют справочник, читатели проверяют согласованность каждой полученной версии:
+ * маршрут Line проходит через последнюю добавленную остановку, число остановок совпадает с её номером,
+ * расстояния маршрута Ring соответствуют его статистике, а остановки из отклонённых изменений не видны
+ */
+void TestConcurrentReadersAndWriters() {
+    constexpr int kWriters = 2;
+    constexpr int kReaders = 4;
+    constexpr int kUpdates = 400;
+    constexpr int kBaseStops = 4;
+
+    transport::VersionedCatalogue catalogue;
+    catalogue.Update({{{"R0"sv, {55.60, 37.50}}, {"R1"sv, {55.61, 37.51}}, {"R2"sv, {55.62, 37.49}}, {"N0"sv, {55.6, 37.6}}},
+                      {{"R0"sv, "R1"sv, 1000}, {"R1"sv, "R2"sv, 1000}, {"R2"sv, "R0"sv, 1000}},
+                      {{"Ring"sv, {"R0"sv, "R1"sv, "R2"sv, "R0"sv}, true}, {"Line"sv, {"R0"sv, "N0"sv, "R0"sv}, false}}});
+
+    std::atomic<bool> done = false;
+    std::atomic<int> next_stop = 1;
+    std::atomic<int> rejected = 0;
+    std::vector<std::thread> threads;
+    for (int writer = 0; writer < kWriters; ++writer) {
+        threads.emplace_back([&, writer]() {
+            DeltaMaker names;
+            for (int update = 0; update < kUpdates; ++update) {
+                if (update % 7 == 3) {
+                    // Остановка и маршрут через неизвестную остановку: набор отклоняется целиком
+                    try {
+                        catalogue.Update({{{"Bad"sv, {55.6, 37.6}}}, {}, {{"Line"sv, {"Bad"sv, "Missing"sv}, false}}});
+                    } catch (const std::out_of_range&) {
+                        ++rejected;
+                    }
+                } else if (update % 5 == 0) {
+                    // Номер выдаётся под блокировкой писателя, поэтому остановки добавляются по порядку
+                    static std::mutex order_mutex;
+                    std::lock_guard guard(order_mutex);
+                    const int index = next_stop++;
+                    const auto name = names.Name("N" + std::to_string(index));
+                    catalogue.Update({{{name, {55.6 + index / 10000.0, 37.6}}}, {}, {{"Line"sv, {"R0"sv, name, "R0"sv}, false}}});
+                } else {
+                    const int distance = 1000 + writer * kUpdates + update;
+                    catalogue.Update({{{"R1"sv, {55.61 + update / 100000.0, 37.51}}},
+                                      {{"R0"sv, "R1"sv, distance}, {"R1"sv, "R0"sv, distance}}, {}});
+                }
+            }
+        });
+    }
+
+    std::atomic<size_t> checked = 0;
+    for (int reader = 0; reader < kReaders; ++reader) {
+        threads.emplace_back([&]() {
+            uint64_t last_revision = 0;
+            while (!done) {
+                const auto version = catalogue.Acquire();
+                CHECK(version->GetRevision() >= last_revision);
+                last_revision = version->GetRevision();
+
+                CHECK(!version->GetStop("Bad"sv));
+                const auto line = version->GetBus("Line"sv);
+                CHECK(line);
+                const auto route = version->GetRoute(*line);
+                CHECK(route.size() == 3);
+                const auto last = version->GetStopName(route[1]);
+                CHECK(last.substr(0, 1) == "N"sv);
+                const int index = std::stoi(std::string(last.substr(1)));
+                CHECK(version->GetStopCount() == static_cast<size_t>(kBaseStops + index));
+                CHECK(version->GetStopBuses(route[1]).size() == 1);
+
+                const auto ring = version->GetBus("Ring"sv);
+                int sum = 0;
+                for (const int distance : version->GetRouteDistances(*ring)) {
+                    sum += distance;
+                }
+                CHECK(version->GetStat(ring)->dist == sum);
+                ++checked;
+            }
+        });
+    }
+
+    for (int writer = 0; writer < kWriters; ++writer) {
+        threads[writer].join();
+    }
+    done = true;
+    for (size_t i = kWriters; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+
+    CHECK(checked > 0);
+    CHECK(rejected == kWriters * ((kUpdates + 3) / 7));
+    const auto final_version = catalogue.Acquire();
+    CHECK(final_version->GetStopCount() == static_cast<size_t>(kBaseStops - 1 + next_stop));
+    CHECK(!final_version->GetStop("Bad"sv));
+}
+
+}
+
+int main() {
+    TestIncrementalFreezeMatchesFull();
+    TestOnlyChangedPartsRebuilt();
+    TestConcurrentReadersAndWriters();
+    std::cout << "versioned_catalogue_test: OK\n";
+}
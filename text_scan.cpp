@@ -0,0 +1,105 @@
+#include "text_scan.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define TEXT_SCAN_X86
+#endif
+
+namespace text_scan {
+
+namespace {
+
+template <char... Cs>
+const char* FindScalar(const char* begin, const char* end) {
+    while (begin != end && !((*begin == Cs) || ...)) {
+        ++begin;
+    }
+    return begin;
+}
+
+#ifdef TEXT_SCAN_X86
+
+// Отмечает байты блока, совпадающие с одним из символов Cs
+template <char... Cs>
+__m128i MatchSse2(__m128i block) {
+    __m128i found = _mm_setzero_si128();
+    ((found = _mm_or_si128(found, _mm_cmpeq_epi8(block, _mm_set1_epi8(Cs)))), ...);
+    return found;
+}
+
+template <char... Cs>
+__attribute__((target("avx2")))
+__m256i MatchAvx2(__m256i block) {
+    __m256i found = _mm256_setzero_si256();
+    ((found = _mm256_or_si256(found, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(Cs)))), ...);
+    return found;
+}
+
+template <char... Cs>
+const char* FindSse2(const char* begin, const char* end) {
+    while (end - begin >= 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        const int mask = _mm_movemask_epi8(MatchSse2<Cs...>(block));
+        if (mask != 0) {
+            return begin + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+        begin += 16;
+    }
+    return FindScalar<Cs...>(begin, end);
+}
+
+template <char... Cs>
+__attribute__((target("avx2")))
+const char* FindAvx2(const char* begin, const char* end) {
+    while (end - begin >= 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+        const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(MatchAvx2<Cs...>(block)));
+        if (mask != 0) {
+            return begin + __builtin_ctz(mask);
+        }
+        begin += 32;
+    }
+    return FindSse2<Cs...>(begin, end);
+}
+
+#endif
+
+using FindFunction = const char* (*)(const char*, const char*);
+
+// Выбирает самый широкий вариант поиска, который поддерживает процессор
+template <char... Cs>
+FindFunction SelectFind() {
+#ifdef TEXT_SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return &FindAvx2<Cs...>;
+    }
+    return &FindSse2<Cs...>;
+#else
+    return &FindScalar<Cs...>;
+#endif
+}
+
+}
+
+const char* FindJsonStringSpecial(const char* begin, const char* end) {
+    static const FindFunction find = SelectFind<'"', '\\', '\n', '\r'>();
+    return find(begin, end);
+}
+
+const char* FindJsonStructural(const char* begin, const char* end) {
+    static const FindFunction find = SelectFind<'"', '[', ']', '{', '}'>();
+    return find(begin, end);
+}
+
+const char* FindJsonEscape(const char* begin, const char* end) {
+    static const FindFunction find = SelectFind<'"', '\\', '\n', '\r', '\t'>();
+    return find(begin, end);
+}
+
+const char* FindXmlEscape(const char* begin, const char* end) {
+    static const FindFunction find = SelectFind<'"', '\'', '<', '>', '&'>();
+    return find(begin, end);
+}
+
+}  // namespace text_scan
@@ -0,0 +1,24 @@
+#pragma once
+
+/*
+ * Поиск символов, требующих особой обработки при разборе и выводе строк.
+ * Строка просматривается блоками по 16 (SSE2) или 32 (AVX2) байта,
+ * вариант выбирается во время выполнения по возможностям процессора.
+ * На других архитектурах используется посимвольный просмотр
+ */
+
+namespace text_scan {
+
+// Первый из символов " \ \n \r: конец или особый символ строкового литерала JSON
+const char* FindJsonStringSpecial(const char* begin, const char* end);
+
+// Первый из символов " [ ] { }: граница строки или контейнера JSON
+const char* FindJsonStructural(const char* begin, const char* end);
+
+// Первый символ, который экранируется при выводе строки JSON: " \ \n \r \t
+const char* FindJsonEscape(const char* begin, const char* end);
+
+// Первый символ, который экранируется в тексте XML: " ' < > &
+const char* FindXmlEscape(const char* begin, const char* end);
+
+}  // namespace text_scan
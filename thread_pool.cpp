@@ -0,0 +1,156 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+size_t GetDefaultThreadCount() {
+    return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+ThreadPool::ThreadPool(size_t threads) {
+    threads = std::max<size_t>(threads, 1);
+    for (size_t i = 0; i < threads; ++i) {
+        ranges_.push_back(std::make_unique<Range>());
+    }
+    workers_.reserve(threads - 1);
+    for (size_t i = 1; i < threads; ++i) {
+        workers_.emplace_back([this, i]() {
+            WorkerLoop(i);
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard guard(mutex_);
+        stop_ = true;
+    }
+    start_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::GetThreadCount() const {
+    return ranges_.size();
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0) {
+        return;
+    }
+    std::lock_guard run_guard(run_mutex_);
+    if (workers_.empty() || count == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    // Задачи делятся между потоками поровну непрерывными диапазонами
+    const size_t threads = ranges_.size();
+    for (size_t i = 0; i < threads; ++i) {
+        std::lock_guard guard(ranges_[i]->mutex);
+        ranges_[i]->begin = count * i / threads;
+        ranges_[i]->end = count * (i + 1) / threads;
+    }
+    task_ = &task;
+    error_index_ = count;
+    error_ = nullptr;
+    {
+        std::lock_guard guard(mutex_);
+        ++generation_;
+        running_ = workers_.size();
+    }
+    start_.notify_all();
+
+    RunTasks(0);
+
+    std::unique_lock lock(mutex_);
+    finish_.wait(lock, [this]() {
+        return running_ == 0;
+    });
+    task_ = nullptr;
+    if (error_) {
+        std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+}
+
+void ThreadPool::WorkerLoop(size_t index) {
+    size_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            start_.wait(lock, [this, seen]() {
+                return stop_ || generation_ != seen;
+            });
+            if (stop_) {
+                return;
+            }
+            seen = generation_;
+        }
+        RunTasks(index);
+        {
+            std::lock_guard guard(mutex_);
+            --running_;
+        }
+        finish_.notify_one();
+    }
+}
+
+void ThreadPool::RunTasks(size_t index) {
+    size_t task = 0;
+    while (true) {
+        if (!TakeTask(index, task)) {
+            if (!Steal(index)) {
+                return;
+            }
+            continue;
+        }
+        try {
+            (*task_)(task);
+        } catch (...) {
+            std::lock_guard guard(error_mutex_);
+            if (task < error_index_) {
+                error_index_ = task;
+                error_ = std::current_exception();
+            }
+        }
+    }
+}
+
+bool ThreadPool::TakeTask(size_t index, size_t& task) {
+    Range& range = *ranges_[index];
+    std::lock_guard guard(range.mutex);
+    if (range.begin == range.end) {
+        return false;
+    }
+    task = range.begin++;
+    return true;
+}
+
+bool ThreadPool::Steal(size_t index) {
+    const size_t threads = ranges_.size();
+    for (size_t offset = 1; offset < threads; ++offset) {
+        Range& victim = *ranges_[(index + offset) % threads];
+        size_t begin = 0;
+        size_t end = 0;
+        {
+            std::lock_guard guard(victim.mutex);
+            if (victim.begin == victim.end) {
+                continue;
+            }
+            // Владельцу остаётся первая половина, чтобы он продолжал идти по порядку
+            const size_t middle = victim.begin + (victim.end - victim.begin) / 2;
+            begin = middle;
+            end = victim.end;
+            victim.end = middle;
+        }
+        Range& own = *ranges_[index];
+        std::lock_guard guard(own.mutex);
+        own.begin = begin;
+        own.end = end;
+        return true;
+    }
+    return false;
+}
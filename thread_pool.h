@@ -0,0 +1,69 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Пул потоков для параллельных циклов по независимым задачам.
+ * Каждый поток получает свой непрерывный диапазон номеров задач и берёт их по одной с начала.
+ * Освободившийся поток забирает у другого вторую половину оставшегося диапазона,
+ * поэтому неравные по стоимости задачи распределяются равномерно, а соседние задачи
+ * обычно выполняются одним потоком
+ */
+
+// Число потоков по умолчанию: количество аппаратных потоков, но не меньше одного
+size_t GetDefaultThreadCount();
+
+class ThreadPool {
+public:
+    // Число потоков считая вызывающий: пул запускает threads - 1 рабочих потоков
+    explicit ThreadPool(size_t threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t GetThreadCount() const;
+
+    // Выполняет task(i) для всех i из [0, count) и дожидается завершения.
+    // Вызывающий поток тоже выполняет задачи. После завершения всех задач пробрасывается
+    // исключение задачи с наименьшим номером, чтобы ошибка не зависела от порядка выполнения.
+    // Циклы из разных потоков выполняются по очереди
+    void ParallelFor(size_t count, const std::function<void(size_t)>& task);
+
+private:
+    // Ещё не начатые задачи потока
+    struct Range {
+        std::mutex mutex;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    void WorkerLoop(size_t index);
+    // Выполняет задачи своего диапазона, затем забирает задачи у других потоков
+    void RunTasks(size_t index);
+    bool TakeTask(size_t index, size_t& task);
+    bool Steal(size_t index);
+
+    std::vector<std::unique_ptr<Range>> ranges_;
+    std::vector<std::thread> workers_;
+
+    std::mutex run_mutex_;
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable finish_;
+    size_t generation_ = 0;
+    size_t running_ = 0;
+    bool stop_ = false;
+
+    const std::function<void(size_t)>* task_ = nullptr;
+    std::mutex error_mutex_;
+    size_t error_index_ = 0;
+    std::exception_ptr error_;
+};
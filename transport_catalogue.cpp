@@ -1,80 +1,447 @@
-#include <unordered_set>
+#include <algorithm>
+#include <numeric>
 
 #include "transport_catalogue.h"
 #include "geo.h"
 #include <sstream>
+#include <unordered_set>
 
 using namespace transport;
 using namespace geo;
+using namespace std::literals;
 
-std::string_view TransportCatalogue::AddId(const std::string_view id) {
-    ids_.push_front(std::string {id});
-    return {ids_.front().begin(), ids_.front().end()};
+void CatalogueBuilder::AddStop(const std::string_view id, const Coordinates place) {
+    auto stop_ptr = stop_ids_.find(id);
+    // Повторное описание остановки с теми же координатами не меняет справочник
+    if (stop_ptr != stop_ids_.end() && stop_places_[stop_ptr->second] == place) {
+        return;
+    }
+    ++revision_;
+    places_revision_ = revision_;
+    if (stop_ptr != stop_ids_.end()) {
+        stop_places_[stop_ptr->second] = place;
+        stop_prepared_[stop_ptr->second] = Prepare(place);
+        InvalidateStopStats(stop_ptr->second);
+        return;
+    }
+    names_revision_ = revision_;
+    const auto stop = static_cast<StopId>(stop_names_.size());
+    stop_ids_.emplace(stop_names_.emplace_back(id), stop);
+    stop_places_.push_back(place);
+    stop_prepared_.push_back(Prepare(place));
+    stop_buses_.emplace_back();
 }
 
-void TransportCatalogue::AddStop(const std::string_view id, const Coordinates place) {
-    std::string_view stop_id = AddId(id);
-    stops_.insert({stop_id, {stop_id, place, {}}});
-    busses4stop_.insert({stop_id, {}});
+void CatalogueBuilder::AddBus(const std::string_view id, const std::vector<std::string_view> stops, bool is_roundtrip) {
+    // Остановки проверяются до изменения справочника, чтобы ошибка не оставила его в промежуточном состоянии
+    std::vector<StopId> route;
+    route.reserve(stops.size());
+    for (const auto& stop : stops) {
+        route.push_back(GetStopId(stop, "bus " + std::string(id)));
+    }
+    ++revision_;
+    routes_revision_ = revision_;
+    BusId bus;
+    if (auto bus_ptr = bus_ids_.find(id); bus_ptr == bus_ids_.end()) {
+        names_revision_ = revision_;
+        bus = static_cast<BusId>(bus_names_.size());
+        bus_ids_.emplace(bus_names_.emplace_back(id), bus);
+        bus_routes_.emplace_back();
+        bus_roundtrips_.push_back(is_roundtrip);
+        stat_cache_.emplace_back();
+        bus_revisions_.push_back(revision_);
+    } else {
+        bus = bus_ptr->second;
+        for (const auto stop : bus_routes_[bus]) {
+            auto& buses = stop_buses_[stop];
+            buses.erase(std::remove(buses.begin(), buses.end(), bus), buses.end());
+        }
+        InvalidateBusStat(bus);
+        bus_roundtrips_[bus] = is_roundtrip;
+    }
+    for (const auto stop : route) {
+        auto& buses = stop_buses_[stop];
+        if (std::find(buses.begin(), buses.end(), bus) == buses.end()) {
+            buses.push_back(bus);
+        }
+    }
+    bus_routes_[bus] = std::move(route);
 }
 
-void TransportCatalogue::AddBus(const std::string_view id, const std::vector<std::string_view> stops) {
-    std::string_view bus_id = AddId(id);
-    std::vector<std::string_view> stops_ids;
-    stops_ids.reserve(stops.size());
-    for (const auto& stop : stops) {
-        stops_ids.push_back(stops_.at(stop).id);
-        busses4stop_[stops_ids.back()].insert(bus_id);
-    }
-    busses_.insert({bus_id, {bus_id, std::move(stops_ids)}});
-}
-
-void TransportCatalogue::AddDistance(const std::string_view from, const std::string_view to, const int dist) {
-    stops_.at(from).distances[stops_.at(to).id] = dist;
-}
-
-const BusDescription* TransportCatalogue::GetBus(const std::string_view id) const {
-    auto bus_ptr = busses_.find(id);
-    if (bus_ptr != busses_.end()) {
-        return &bus_ptr->second;
-    }
-    return nullptr;
-}
-
-const std::optional<RouteStatistics> TransportCatalogue::GetStat(const BusDescription* bus) const {
-    if (bus) {
-        double route_length = 0.0;
-        int route_dist = 0;
-        std::unordered_set<std::string_view> unique_stops;
-        std::optional<StopDescription> prev_stop;
-        for (const std::string_view& s : bus->stops) {
-            const auto stop = stops_.at(s);
-            unique_stops.insert(s);
-            if (prev_stop) {
-                const auto& distances = prev_stop->distances;
-                auto dist_ptr = distances.find(s);
-                if (dist_ptr != distances.end()) {
-                    route_dist += dist_ptr->second;
-                } else if (stop.distances.end() != (dist_ptr = stop.distances.find(prev_stop->id))) {
-                    route_dist += dist_ptr->second;
-                } else {
-                    std::stringstream ss;
-                    ss << "distance between stop " << s << " and stop " << prev_stop->id << " not found in base";
-                    throw std::out_of_range(ss.str());
-                }
-                route_length += ComputeDistance(prev_stop->place, stop.place);
+void CatalogueBuilder::AddDistance(const std::string_view from, const std::string_view to, const int dist) {
+    const StopId from_id = GetStopId(from, "road distances");
+    const StopId to_id = GetStopId(to, "road distances of stop " + std::string(from));
+    ++revision_;
+    distances_.Add(from_id, to_id, dist);
+    // Оба направления участка проходят через from, поэтому достаточно сбросить его маршруты
+    InvalidateStopStats(from_id);
+}
+
+void CatalogueBuilder::Apply(const CatalogueDelta& delta) {
+    std::unordered_set<std::string_view> new_stops;
+    for (const auto& stop : delta.stops) {
+        new_stops.insert(stop.name);
+    }
+    auto check = [&](std::string_view stop, auto&& context) {
+        if (!new_stops.count(stop) && !HasStop(stop)) {
+            std::stringstream ss;
+            ss << "stop " << stop << " in " << context() << " not found in base";
+            throw std::out_of_range(ss.str());
+        }
+    };
+    for (const auto& distance : delta.distances) {
+        check(distance.from, [] {
+            return "road distances"s;
+        });
+        check(distance.to, [&distance] {
+            return "road distances of stop "s.append(distance.from);
+        });
+    }
+    for (const auto& bus : delta.buses) {
+        for (const auto stop : bus.stops) {
+            check(stop, [&bus] {
+                return "bus "s.append(bus.name);
+            });
+        }
+    }
+
+    for (const auto& stop : delta.stops) {
+        AddStop(stop.name, stop.place);
+    }
+    for (const auto& distance : delta.distances) {
+        AddDistance(distance.from, distance.to, distance.distance);
+    }
+    for (const auto& bus : delta.buses) {
+        AddBus(bus.name, bus.stops, bus.is_roundtrip);
+    }
+}
+
+bool CatalogueBuilder::HasStop(const std::string_view id) const {
+    return stop_ids_.count(id) > 0;
+}
+
+StopId CatalogueBuilder::GetStopId(const std::string_view id, const std::string_view context) const {
+    if (auto stop_ptr = stop_ids_.find(id); stop_ptr != stop_ids_.end()) {
+        return stop_ptr->second;
+    }
+    std::stringstream ss;
+    ss << "stop " << id << " in " << context << " not found in base";
+    throw std::out_of_range(ss.str());
+}
+
+void CatalogueBuilder::InvalidateStopStats(StopId stop) {
+    for (const auto bus : stop_buses_[stop]) {
+        InvalidateBusStat(bus);
+    }
+}
+
+void CatalogueBuilder::InvalidateBusStat(BusId bus) {
+    stat_cache_[bus].reset();
+    bus_revisions_[bus] = revision_;
+}
+
+RouteStatistics CatalogueBuilder::ComputeStat(BusId bus) const {
+    const auto& route = bus_routes_[bus];
+    int route_dist = 0;
+    for (size_t i = 1; i < route.size(); ++i) {
+        const StopId prev_stop = route[i - 1];
+        const StopId stop = route[i];
+        const auto dist = distances_.Find(prev_stop, stop);
+        if (!dist) {
+            std::stringstream ss;
+            ss << "distance between stop " << stop_names_[stop] << " and stop " << stop_names_[prev_stop] << " not found in base";
+            throw std::out_of_range(ss.str());
+        }
+        route_dist += *dist;
+    }
+    // Расстояния между соседними остановками считаются одним пакетом
+    std::vector<PreparedCoordinates> points;
+    points.reserve(route.size());
+    for (const auto stop : route) {
+        points.push_back(stop_prepared_[stop]);
+    }
+    double route_length = 0.0;
+    if (points.size() > 1) {
+        std::vector<double> distances(points.size() - 1);
+        ComputeDistances(std::span(points).first(distances.size()), std::span(points).subspan(1), distances);
+        for (const double distance : distances) {
+            route_length += distance;
+        }
+    }
+    std::vector<StopId> unique_stops(route);
+    std::sort(unique_stops.begin(), unique_stops.end());
+    const auto unique_count = std::unique(unique_stops.begin(), unique_stops.end()) - unique_stops.begin();
+    return RouteStatistics {route_dist, route.size(), static_cast<size_t>(unique_count), route_dist / route_length};
+}
+
+uint64_t CatalogueBuilder::GetRevision() const {
+    return revision_;
+}
+
+StatCacheCounters CatalogueBuilder::GetStatCacheCounters() const {
+    return stat_cache_counters_;
+}
+
+FreezeCounters CatalogueBuilder::GetFreezeCounters() const {
+    return freeze_counters_;
+}
+
+namespace {
+
+// Номера в порядке возрастания названий
+std::vector<uint32_t> SortByName(const std::deque<std::string>& names) {
+    std::vector<uint32_t> order(names.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&names](uint32_t lhs, uint32_t rhs) {
+        return names[lhs] < names[rhs];
+    });
+    return order;
+}
+
+// Копирует названия в общий буфер в порядке order
+std::vector<std::string_view> CopyNames(const std::deque<std::string>& names, const std::vector<uint32_t>& order,
+                                        std::vector<char>& buffer, size_t& used) {
+    std::vector<std::string_view> views;
+    views.reserve(order.size());
+    for (const auto id : order) {
+        const auto& name = names[id];
+        std::copy(name.begin(), name.end(), buffer.begin() + used);
+        views.emplace_back(buffer.data() + used, name.size());
+        used += name.size();
+    }
+    return views;
+}
+
+}
+
+FrozenCatalogue CatalogueBuilder::Freeze(const FrozenCatalogue* previous) const {
+    using Frozen = FrozenCatalogue;
+    Frozen frozen;
+    frozen.revision_ = revision_;
+    // Часть предыдущей версии годится, если её исходные данные не менялись после её построения
+    auto unchanged = [previous](uint64_t part_revision) {
+        return previous && part_revision <= previous->revision_;
+    };
+
+    if (unchanged(names_revision_)) {
+        frozen.names_ = previous->names_;
+    } else {
+        ++freeze_counters_.names;
+        auto names = std::make_shared<Frozen::Names>();
+        // Новые номера совпадают с позицией названия в алфавитном порядке
+        names->stop_order = SortByName(stop_names_);
+        names->bus_order = SortByName(bus_names_);
+        names->stop_index.resize(names->stop_order.size());
+        for (size_t i = 0; i < names->stop_order.size(); ++i) {
+            names->stop_index[names->stop_order[i]] = static_cast<StopId>(i);
+        }
+        names->bus_index.resize(names->bus_order.size());
+        for (size_t i = 0; i < names->bus_order.size(); ++i) {
+            names->bus_index[names->bus_order[i]] = static_cast<BusId>(i);
+        }
+
+        size_t names_size = 0;
+        for (const auto& name : stop_names_) {
+            names_size += name.size();
+        }
+        for (const auto& name : bus_names_) {
+            names_size += name.size();
+        }
+        // Размер буфера задаётся один раз, чтобы ссылки на названия не менялись
+        names->buffer.resize(names_size);
+        size_t used = 0;
+        names->stop_names = CopyNames(stop_names_, names->stop_order, names->buffer, used);
+        names->bus_names = CopyNames(bus_names_, names->bus_order, names->buffer, used);
+        names->stop_ids.reserve(names->stop_names.size());
+        for (size_t i = 0; i < names->stop_names.size(); ++i) {
+            names->stop_ids.emplace(names->stop_names[i], static_cast<StopId>(i));
+        }
+        names->bus_ids.reserve(names->bus_names.size());
+        for (size_t i = 0; i < names->bus_names.size(); ++i) {
+            names->bus_ids.emplace(names->bus_names[i], static_cast<BusId>(i));
+        }
+        frozen.names_ = std::move(names);
+    }
+    const auto& names = *frozen.names_;
+    const bool same_names = previous && frozen.names_ == previous->names_;
+
+    if (unchanged(places_revision_)) {
+        frozen.places_ = previous->places_;
+    } else {
+        ++freeze_counters_.places;
+        auto places = std::make_shared<Frozen::Places>();
+        places->stop_places.reserve(names.stop_order.size());
+        for (const auto stop : names.stop_order) {
+            places->stop_places.push_back(stop_places_[stop]);
+        }
+        places->stop_index = StopIndex(places->stop_places);
+        frozen.places_ = std::move(places);
+    }
+
+    // Маршруты через остановку ссылаются на названия, поэтому с новыми названиями строятся заново
+    if (same_names && unchanged(routes_revision_)) {
+        frozen.routes_ = previous->routes_;
+    } else {
+        ++freeze_counters_.routes;
+        auto routes = std::make_shared<Frozen::Routes>();
+        routes->route_offsets.reserve(names.bus_order.size() + 1);
+        routes->route_offsets.push_back(0);
+        routes->bus_roundtrips.reserve(names.bus_order.size());
+        for (const auto bus : names.bus_order) {
+            for (const auto stop : bus_routes_[bus]) {
+                routes->route_stops.push_back(names.stop_index[stop]);
             }
-            prev_stop = stop;
+            routes->route_offsets.push_back(static_cast<uint32_t>(routes->route_stops.size()));
+            routes->bus_roundtrips.push_back(bus_roundtrips_[bus]);
         }
-        return RouteStatistics {route_dist, bus->stops.size(), unique_stops.size(), route_dist / route_length};
+
+        routes->stop_bus_offsets.reserve(names.stop_order.size() + 1);
+        routes->stop_bus_offsets.push_back(0);
+        std::vector<BusId> buses;
+        for (const auto stop : names.stop_order) {
+            // Номера маршрутов упорядочены так же, как их названия
+            buses.clear();
+            for (const auto bus : stop_buses_[stop]) {
+                buses.push_back(names.bus_index[bus]);
+            }
+            std::sort(buses.begin(), buses.end());
+            for (const auto bus : buses) {
+                routes->stop_buses.push_back(names.bus_names[bus]);
+            }
+            routes->stop_bus_offsets.push_back(static_cast<uint32_t>(routes->stop_buses.size()));
+        }
+        frozen.routes_ = std::move(routes);
+    }
+    const auto& routes = *frozen.routes_;
+
+    // Записывает расстояния по дорогам и статистику маршрута bus, взятую из кэша или вычисленную заново
+    auto freeze_bus = [this, &names, &routes](BusId bus, Frozen::Stats& stats) {
+        ++freeze_counters_.bus_stats;
+        const auto& route = bus_routes_[bus];
+        const BusId frozen_bus = names.bus_index[bus];
+        int* distances = stats.route_distances.data() + routes.route_offsets[frozen_bus];
+        for (size_t i = 0; i < route.size(); ++i) {
+            const auto dist = i > 0 ? distances_.Find(route[i - 1], route[i]) : 0;
+            distances[i] = dist.value_or(Frozen::kNoDistance);
+        }
+
+        auto& bus_stat = stats.bus_stats[frozen_bus];
+        bus_stat.error.clear();
+        auto& cached = stat_cache_[bus];
+        if (cached) {
+            ++stat_cache_counters_.hits;
+            bus_stat.stat = *cached;
+            return;
+        }
+        ++stat_cache_counters_.misses;
+        try {
+            cached = ComputeStat(bus);
+            bus_stat.stat = *cached;
+        } catch (const std::out_of_range& e) {
+            bus_stat.error = e.what();
+        }
+    };
+
+    // При тех же смещениях маршрутов достаточно обновить изменённые маршруты в копии предыдущей статистики
+    const bool same_routes = previous && frozen.routes_ == previous->routes_;
+    std::vector<BusId> changed;
+    for (BusId bus = 0; bus < bus_revisions_.size(); ++bus) {
+        if (!same_routes || bus_revisions_[bus] > previous->revision_) {
+            changed.push_back(bus);
+        }
+    }
+    if (same_routes && changed.empty()) {
+        frozen.stats_ = previous->stats_;
+    } else {
+        auto stats = same_routes ? std::make_shared<Frozen::Stats>(*previous->stats_)
+                                 : std::make_shared<Frozen::Stats>();
+        stats->route_distances.resize(routes.route_stops.size());
+        stats->bus_stats.resize(names.bus_order.size());
+        for (const auto bus : changed) {
+            freeze_bus(bus, *stats);
+        }
+        frozen.stats_ = std::move(stats);
+    }
+    return frozen;
+}
+
+std::optional<StopId> FrozenCatalogue::GetStop(const std::string_view id) const {
+    if (auto stop_ptr = names_->stop_ids.find(id); stop_ptr != names_->stop_ids.end()) {
+        return stop_ptr->second;
+    }
+    return std::nullopt;
+}
+
+std::optional<BusId> FrozenCatalogue::GetBus(const std::string_view id) const {
+    if (auto bus_ptr = names_->bus_ids.find(id); bus_ptr != names_->bus_ids.end()) {
+        return bus_ptr->second;
     }
     return std::nullopt;
 }
 
-const std::set<BusPtr>* TransportCatalogue::GetBusses4Stop(const std::string_view id) const {
-    auto busses4stop_ptr = busses4stop_.find(id);
-    if (busses4stop_ptr != busses4stop_.end()) {
-        return &busses4stop_ptr->second;
+const std::optional<RouteStatistics> FrozenCatalogue::GetStat(std::optional<BusId> bus) const {
+    if (!bus) {
+        return std::nullopt;
+    }
+    const auto& bus_stat = stats_->bus_stats[*bus];
+    if (!bus_stat.error.empty()) {
+        throw std::out_of_range(bus_stat.error);
+    }
+    return bus_stat.stat;
+}
+
+std::optional<std::span<const std::string_view>> FrozenCatalogue::GetBusses4Stop(const std::string_view id) const {
+    if (const auto stop = GetStop(id)) {
+        return GetStopBuses(*stop);
     }
-    return nullptr;
+    return std::nullopt;
+}
+
+size_t FrozenCatalogue::GetStopCount() const {
+    return names_->stop_names.size();
+}
+
+std::string_view FrozenCatalogue::GetStopName(StopId stop) const {
+    return names_->stop_names[stop];
+}
+
+geo::Coordinates FrozenCatalogue::GetStopPlace(StopId stop) const {
+    return places_->stop_places[stop];
+}
+
+const StopIndex& FrozenCatalogue::GetStopIndex() const {
+    return places_->stop_index;
+}
+
+std::span<const std::string_view> FrozenCatalogue::GetStopBuses(StopId stop) const {
+    const auto& buses = routes_->stop_buses;
+    const auto& offsets = routes_->stop_bus_offsets;
+    return {buses.data() + offsets[stop], buses.data() + offsets[stop + 1]};
+}
+
+size_t FrozenCatalogue::GetBusCount() const {
+    return names_->bus_names.size();
+}
+
+std::string_view FrozenCatalogue::GetBusName(BusId bus) const {
+    return names_->bus_names[bus];
+}
+
+std::span<const StopId> FrozenCatalogue::GetRoute(BusId bus) const {
+    const auto& offsets = routes_->route_offsets;
+    return {routes_->route_stops.data() + offsets[bus], routes_->route_stops.data() + offsets[bus + 1]};
+}
+
+std::span<const int> FrozenCatalogue::GetRouteDistances(BusId bus) const {
+    const auto& offsets = routes_->route_offsets;
+    const auto& distances = stats_->route_distances;
+    return {distances.data() + offsets[bus], distances.data() + offsets[bus + 1]};
+}
+
+bool FrozenCatalogue::IsRoundtrip(BusId bus) const {
+    return routes_->bus_roundtrips[bus];
+}
+
+uint64_t FrozenCatalogue::GetRevision() const {
+    return revision_;
 }
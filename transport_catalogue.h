@@ -1,33 +1,25 @@
 #pragma once
 
 #include <vector>
-#include <unordered_set>
-#include <set>
 #include <stdexcept>
 #include <string>
 #include <optional>
 #include <unordered_map>
 #include <iostream>
-#include <forward_list>
+#include <deque>
+#include <cstdint>
+#include <span>
+#include <memory>
 
 #include "geo.h"
 #include "domain.h"
+#include "road_distances.h"
+#include "stop_index.h"
 
 namespace transport {
     
-    using StopsMap = std::unordered_map<std::string_view, int>;
-    using BusPtr = std::string_view;
-    
-    struct StopDescription {
-        std::string_view id;
-        geo::Coordinates place;
-        StopsMap distances;
-    };
-
-    struct BusDescription {
-        std::string_view id;
-        std::vector<std::string_view> stops;
-    };
+    using StopId = uint32_t;
+    using BusId = uint32_t;
 
     struct RouteStatistics {
         int dist = 0;
@@ -36,21 +28,203 @@ namespace transport {
         double curvature = 0.0;
     };
 
-    class TransportCatalogue {
+    struct StatCacheCounters {
+        size_t hits = 0;
+        size_t misses = 0;
+    };
+
+    // Сколько раз Freeze построил каждую часть неизменяемого справочника заново
+    // и для скольких маршрутов пересчитал расстояния и статистику
+    struct FreezeCounters {
+        size_t names = 0;
+        size_t places = 0;
+        size_t routes = 0;
+        size_t bus_stats = 0;
+    };
+
+    /*
+     * Набор изменений справочника, который применяется и публикуется целиком.
+     * Названия ссылаются на строки вызывающего, которые должны жить до конца применения
+     */
+    struct CatalogueDelta {
+        struct Stop {
+            std::string_view name;
+            geo::Coordinates place;
+        };
+        struct Distance {
+            std::string_view from;
+            std::string_view to;
+            int distance;
+        };
+        struct Bus {
+            std::string_view name;
+            // Некольцевой маршрут передаётся полностью: туда и обратно
+            std::vector<std::string_view> stops;
+            bool is_roundtrip;
+        };
+
+        std::vector<Stop> stops;
+        std::vector<Distance> distances;
+        std::vector<Bus> buses;
+    };
+
+    class FrozenCatalogue;
+
+    /*
+     * Изменяемая часть справочника: сюда добавляются остановки, расстояния и маршруты.
+     * Названия хранятся один раз и переводятся в плотные номера в порядке добавления.
+     * Данные остановок лежат в параллельных массивах, маршруты хранятся как последовательности StopId.
+     * Запросы к базе выполняются к неизменяемому справочнику, который строит Freeze
+     */
+    class CatalogueBuilder {
     public:
         void AddStop(const std::string_view id, const geo::Coordinates place);
-        void AddBus(const std::string_view id, std::vector<std::string_view> stops);
+        // Некольцевой маршрут передаётся полностью: туда и обратно.
+        // AddBus и AddDistance бросают out_of_range, если остановка не добавлена, и не меняют справочник
+        void AddBus(const std::string_view id, std::vector<std::string_view> stops, bool is_roundtrip);
         void AddDistance(const std::string_view from, const std::string_view to, const int dists);
-        const BusDescription* GetBus(const std::string_view id) const;
-        const std::optional<RouteStatistics> GetStat(const BusDescription* bus) const;
-        const std::set<BusPtr>* GetBusses4Stop(const std::string_view id) const;
+        bool HasStop(const std::string_view id) const;
+        // Добавляет остановки, затем расстояния, затем маршруты. Остановки из расстояний и маршрутов
+        // проверяются до изменения справочника: если какой-то нет ни в нём, ни среди добавляемых,
+        // бросает out_of_range с её названием, и справочник не меняется
+        void Apply(const CatalogueDelta& delta);
+
+        // Если передана предыдущая версия, замороженная из этого же справочника, части, не изменённые
+        // с тех пор, берутся из неё без копирования, а статистика пересчитывается только для изменённых маршрутов.
+        // Новая остановка или маршрут меняют нумерацию по названиям, поэтому тогда все части строятся заново
+        FrozenCatalogue Freeze(const FrozenCatalogue* previous = nullptr) const;
+        // Число изменений справочника. Версии, замороженные при одной ревизии, совпадают
+        uint64_t GetRevision() const;
+
+        // Сколько раз Freeze взял статистику маршрута из кэша и сколько раз вычислил её заново
+        StatCacheCounters GetStatCacheCounters() const;
+        FreezeCounters GetFreezeCounters() const;
+    private:
+        // Бросает out_of_range с названием остановки и описанием места, где она упомянута
+        StopId GetStopId(const std::string_view id, const std::string_view context) const;
+        RouteStatistics ComputeStat(BusId bus) const;
+        void InvalidateStopStats(StopId stop);
+        void InvalidateBusStat(BusId bus);
     private:
-        std::string_view AddId(const std::string_view id);
+        // deque не перемещает строки при добавлении, поэтому на них могут ссылаться ключи словарей
+        std::deque<std::string> stop_names_;
+        std::vector<geo::Coordinates> stop_places_;
+        // Координаты в радианах и косинус широты для пакетного расчёта длины маршрутов
+        std::vector<geo::PreparedCoordinates> stop_prepared_;
+        // Маршруты через остановку без повторов, нужны для сброса кэша статистики
+        std::vector<std::vector<BusId>> stop_buses_;
+        std::unordered_map<std::string_view, StopId> stop_ids_;
+
+        std::deque<std::string> bus_names_;
+        std::vector<std::vector<StopId>> bus_routes_;
+        std::vector<bool> bus_roundtrips_;
+        std::unordered_map<std::string_view, BusId> bus_ids_;
+
+        RoadDistances distances_;
+        uint64_t revision_ = 0;
+        // Ревизии последнего изменения данных, из которых строятся части неизменяемого справочника
+        uint64_t names_revision_ = 0;
+        uint64_t places_revision_ = 0;
+        uint64_t routes_revision_ = 0;
+        // Ревизия последнего изменения маршрута, координат его остановок или расстояний между ними
+        std::vector<uint64_t> bus_revisions_;
+
+        // Статистика маршрутов переживает Freeze и сбрасывается при изменении маршрута,
+        // координат его остановок или расстояний между ними
+        mutable std::vector<std::optional<RouteStatistics>> stat_cache_;
+        mutable StatCacheCounters stat_cache_counters_;
+        mutable FreezeCounters freeze_counters_;
+    };
+
+    /*
+     * Неизменяемый справочник, оптимизированный для чтения.
+     * Остановки и маршруты перенумерованы в порядке названий, все данные лежат в плоских массивах:
+     * маршруты через остановку и остановки маршрутов хранятся подряд (CSR) и адресуются смещениями.
+     * Статистика маршрутов вычислена при построении.
+     * Части справочника разделяются между копиями и версиями, поэтому копирование дешёвое
+     */
+    class FrozenCatalogue {
+    public:
+        std::optional<StopId> GetStop(const std::string_view id) const;
+        std::optional<BusId> GetBus(const std::string_view id) const;
+        // Бросает out_of_range, если для маршрута не хватает расстояний между остановками
+        const std::optional<RouteStatistics> GetStat(std::optional<BusId> bus) const;
+        // Названия маршрутов через остановку в алфавитном порядке
+        std::optional<std::span<const std::string_view>> GetBusses4Stop(const std::string_view id) const;
+
+        size_t GetStopCount() const;
+        std::string_view GetStopName(StopId stop) const;
+        geo::Coordinates GetStopPlace(StopId stop) const;
+        // Пространственный индекс остановок строится при заморозке справочника
+        const StopIndex& GetStopIndex() const;
+        std::span<const std::string_view> GetStopBuses(StopId stop) const;
+        size_t GetBusCount() const;
+        std::string_view GetBusName(BusId bus) const;
+        std::span<const StopId> GetRoute(BusId bus) const;
+        // Расстояние по дорогам до каждой остановки маршрута от предыдущей, kNoDistance если оно неизвестно.
+        // Для первой остановки 0
+        std::span<const int> GetRouteDistances(BusId bus) const;
+        bool IsRoundtrip(BusId bus) const;
+
+        static constexpr int kNoDistance = -1;
+
+        // Ревизия справочника, из которой построена эта версия
+        uint64_t GetRevision() const;
     private:
-        std::forward_list<std::string> ids_;
-        std::unordered_map<std::string_view, StopDescription> stops_;
-        std::unordered_map<std::string_view, BusDescription> busses_;
-        std::unordered_map<std::string_view, std::set<std::string_view>> busses4stop_;
+        friend class CatalogueBuilder;
+        FrozenCatalogue() = default;
+
+        struct BusStat {
+            RouteStatistics stat;
+            // Пусто, если статистика вычислена, иначе текст ошибки
+            std::string error;
+        };
+
+        /*
+         * Справочник состоит из неизменяемых частей, которые следующая версия может разделять
+         * с предыдущей. Названия маршрутов в Routes ссылаются на буфер Names,
+         * поэтому версия с новыми названиями строит Routes заново
+         */
+        struct Names {
+            // Названия остановок, затем маршрутов, в одном буфере
+            std::vector<char> buffer;
+            std::vector<std::string_view> stop_names;
+            std::vector<std::string_view> bus_names;
+            std::unordered_map<std::string_view, StopId> stop_ids;
+            std::unordered_map<std::string_view, BusId> bus_ids;
+            // Номера CatalogueBuilder в порядке названий и обратные им
+            std::vector<uint32_t> stop_order;
+            std::vector<uint32_t> bus_order;
+            std::vector<StopId> stop_index;
+            std::vector<BusId> bus_index;
+        };
+
+        struct Places {
+            std::vector<geo::Coordinates> stop_places;
+            StopIndex stop_index;
+        };
+
+        struct Routes {
+            // Маршруты через остановку stop: stop_buses[stop_bus_offsets[stop], stop_bus_offsets[stop + 1])
+            std::vector<uint32_t> stop_bus_offsets;
+            std::vector<std::string_view> stop_buses;
+            // Остановки маршрута bus: route_stops[route_offsets[bus], route_offsets[bus + 1])
+            std::vector<uint32_t> route_offsets;
+            std::vector<StopId> route_stops;
+            std::vector<bool> bus_roundtrips;
+        };
+
+        // Расстояния по дорогам адресуются смещениями Routes
+        struct Stats {
+            std::vector<int> route_distances;
+            std::vector<BusStat> bus_stats;
+        };
+
+        std::shared_ptr<const Names> names_;
+        std::shared_ptr<const Places> places_;
+        std::shared_ptr<const Routes> routes_;
+        std::shared_ptr<const Stats> stats_;
+        uint64_t revision_ = 0;
     };
     
 }
@@ -0,0 +1,74 @@
+#include "transport_router.h"
+
+#include <stdexcept>
+
+using namespace transport;
+
+namespace {
+
+// Метров в минуту при скорости в км/ч
+constexpr double kMetersPerMinutePerKmh = 1000.0 / 60.0;
+
+}
+
+TransportRouter::TransportRouter(const FrozenCatalogue& catalogue, const RoutingSettings& settings)
+    : catalogue_(catalogue)
+    , settings_(settings) {
+    if (!(settings_.bus_velocity > 0.0) || settings_.bus_wait_time < 0) {
+        throw std::invalid_argument("invalid routing settings");
+    }
+    graph::DirectedWeightedGraph graph(catalogue_.GetStopCount());
+    for (BusId bus = 0; bus < catalogue_.GetBusCount(); ++bus) {
+        const auto stops = catalogue_.GetRoute(bus);
+        const auto distances = catalogue_.GetRouteDistances(bus);
+        if (catalogue_.IsRoundtrip(bus) || stops.size() < 2) {
+            AddRides(graph, bus, stops, distances);
+            continue;
+        }
+        // Некольцевой маршрут хранится туда и обратно, направления делят конечную остановку
+        const size_t middle = stops.size() / 2;
+        AddRides(graph, bus, stops.first(middle + 1), distances.first(middle + 1));
+        AddRides(graph, bus, stops.subspan(middle), distances.subspan(middle));
+    }
+    router_.emplace(graph);
+}
+
+void TransportRouter::AddRides(graph::DirectedWeightedGraph& graph, BusId bus, std::span<const StopId> stops,
+                               std::span<const int> distances) {
+    const double meters_per_minute = settings_.bus_velocity * kMetersPerMinutePerKmh;
+    for (size_t from = 0; from + 1 < stops.size(); ++from) {
+        int distance = 0;
+        // Без расстояния до следующей остановки дальше по маршруту из from не доехать
+        for (size_t to = from + 1; to < stops.size() && distances[to] != FrozenCatalogue::kNoDistance; ++to) {
+            distance += distances[to];
+            const double time = distance / meters_per_minute;
+            graph.AddEdge({stops[from], stops[to], settings_.bus_wait_time + time});
+            rides_.push_back({stops[from], bus, static_cast<int>(to - from), time});
+        }
+    }
+}
+
+std::optional<Journey> TransportRouter::FindRoute(std::string_view from, std::string_view to) const {
+    const auto from_stop = catalogue_.GetStop(from);
+    const auto to_stop = catalogue_.GetStop(to);
+    if (!from_stop || !to_stop) {
+        return std::nullopt;
+    }
+    const auto route = router_->BuildRoute(*from_stop, *to_stop);
+    if (!route) {
+        return std::nullopt;
+    }
+    Journey journey;
+    journey.total_time = route->weight;
+    journey.items.reserve(2 * route->edges.size());
+    for (const auto edge : route->edges) {
+        const Ride& ride = rides_[edge];
+        journey.items.push_back(WaitItem {catalogue_.GetStopName(ride.from), static_cast<double>(settings_.bus_wait_time)});
+        journey.items.push_back(RideItem {catalogue_.GetBusName(ride.bus), ride.span_count, ride.time});
+    }
+    return journey;
+}
+
+const RoutingSettings& TransportRouter::GetSettings() const {
+    return settings_;
+}
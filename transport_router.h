@@ -0,0 +1,68 @@
+#pragma once
+
+#include "domain.h"
+#include "router.h"
+#include "transport_catalogue.h"
+
+#include <optional>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+/*
+ * Поиск самого быстрого пути между остановками.
+ * Вершины графа - остановки. Для каждого направления маршрута из каждой остановки проводятся рёбра
+ * во все следующие остановки этого направления; вес ребра - ожидание автобуса и время поездки в минутах.
+ * Поэтому пересадка всегда начинается с ожидания, а поездка без пересадок - одно ребро.
+ * Граф предобрабатывается один раз при построении, запросы можно выполнять из нескольких потоков
+ */
+
+namespace transport {
+
+struct WaitItem {
+    std::string_view stop;
+    double time = 0.0;
+};
+
+struct RideItem {
+    std::string_view bus;
+    int span_count = 0;
+    double time = 0.0;
+};
+
+using JourneyItem = std::variant<WaitItem, RideItem>;
+
+struct Journey {
+    double total_time = 0.0;
+    std::vector<JourneyItem> items;
+};
+
+class TransportRouter {
+public:
+    // Справочник должен жить дольше маршрутизатора: названия в ответах ссылаются на него
+    TransportRouter(const FrozenCatalogue& catalogue, const RoutingSettings& settings);
+
+    // nullopt, если остановки нет в справочнике или между ними нет пути
+    std::optional<Journey> FindRoute(std::string_view from, std::string_view to) const;
+
+    const RoutingSettings& GetSettings() const;
+
+private:
+    // Поездка, которой соответствует ребро графа
+    struct Ride {
+        StopId from;
+        BusId bus;
+        int span_count;
+        double time;
+    };
+
+    void AddRides(graph::DirectedWeightedGraph& graph, BusId bus, std::span<const StopId> stops,
+                  std::span<const int> distances);
+
+    const FrozenCatalogue& catalogue_;
+    RoutingSettings settings_;
+    std::vector<Ride> rides_;
+    std::optional<graph::Router> router_;
+};
+
+}  // namespace transport
@@ -0,0 +1,25 @@
+#include "versioned_catalogue.h"
+
+using namespace transport;
+
+VersionedCatalogue::VersionedCatalogue()
+    : current_(std::make_shared<const FrozenCatalogue>(builder_.Freeze())) {
+}
+
+VersionedCatalogue::Version VersionedCatalogue::Acquire() const {
+    return current_.load(std::memory_order_acquire);
+}
+
+VersionedCatalogue::Version VersionedCatalogue::Update(const CatalogueDelta& delta) {
+    std::lock_guard guard(writer_mutex_);
+    builder_.Apply(delta);
+    return Publish();
+}
+
+VersionedCatalogue::Version VersionedCatalogue::Publish() {
+    // Писатели работают по очереди, поэтому текущая версия построена из builder_ последней
+    const Version previous = current_.load(std::memory_order_acquire);
+    Version next = std::make_shared<const FrozenCatalogue>(builder_.Freeze(previous.get()));
+    current_.store(next, std::memory_order_release);
+    return next;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "transport_catalogue.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace transport {
+
+/*
+ * Справочник, который можно изменять во время выполнения запросов.
+ * Читатели получают текущую неизменяемую версию копированием атомарного указателя
+ * и работают с ней, сколько нужно: версия освобождается вместе с последней ссылкой на неё.
+ * Писатели по очереди применяют наборы изменений к CatalogueBuilder, замораживают новую версию
+ * и атомарно публикуют её. Построение версии не задерживает читателей:
+ * они ждут только на самой замене указателя.
+ * Новая версия разделяет с предыдущей части, которых не коснулись изменения
+ */
+class VersionedCatalogue {
+public:
+    using Version = std::shared_ptr<const FrozenCatalogue>;
+
+    VersionedCatalogue();
+
+    // Текущая опубликованная версия
+    Version Acquire() const;
+
+    // Применяет изменения и публикует новую версию. Изменения применяются целиком или не применяются вовсе:
+    // при ошибке в них бросает исключение, справочник и опубликованная версия не меняются
+    Version Update(const CatalogueDelta& delta);
+
+private:
+    // Вызывается под writer_mutex_
+    Version Publish();
+
+    std::mutex writer_mutex_;
+    CatalogueBuilder builder_;
+    std::atomic<Version> current_;
+};
+
+}  // namespace transport